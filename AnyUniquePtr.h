@@ -0,0 +1,224 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Rainbow3D {
+
+	struct _Any_deleter_vtable {
+		void (*_destroy)(void* p, void* storage) noexcept;
+		void (*_relocate)(void* dst, void* src) noexcept;
+		void (*_discard)(void* storage) noexcept;
+	};
+
+	template<std::size_t BufferSize>
+	struct _Any_deleter_storage {
+		alignas(void*) unsigned char _buf[BufferSize];
+
+		void* _Storage() noexcept {
+			return _buf;
+		}
+	};
+
+	template<>
+	struct _Any_deleter_storage<0> {
+		void* _Storage() noexcept {
+			return nullptr;
+		}
+	};
+
+	template<typename D>
+	inline constexpr bool _Any_deleter_stateless = std::is_empty_v<D> && std::is_default_constructible_v<D>;
+
+	template<typename D, std::size_t BufferSize>
+	inline constexpr bool _Any_deleter_inline = !_Any_deleter_stateless<D> && sizeof(D) <= BufferSize && alignof(D) <= alignof(void*) && std::is_nothrow_move_constructible_v<D>;
+
+	template<typename T, typename D, std::size_t BufferSize>
+	struct _Any_deleter_ops {
+		static void _Call(void* p, D& d) noexcept {
+			d(static_cast<T*>(p));
+		}
+
+		static constexpr _Any_deleter_vtable _Make() noexcept {
+			if constexpr (_Any_deleter_stateless<D>) {
+				return {
+					[](void* p, void*) noexcept { D d; _Call(p, d); },
+					nullptr,
+					nullptr
+				};
+			}
+			else if constexpr (_Any_deleter_inline<D, BufferSize>) {
+				return {
+					[](void* p, void* storage) noexcept {
+						D& d = *std::launder(static_cast<D*>(storage));
+						_Call(p, d);
+						d.~D();
+					},
+					[](void* dst, void* src) noexcept {
+						D& d = *std::launder(static_cast<D*>(src));
+						::new (dst) D(std::move(d));
+						d.~D();
+					},
+					[](void* storage) noexcept { std::launder(static_cast<D*>(storage))->~D(); }
+				};
+			}
+			else {
+				return {
+					[](void* p, void* storage) noexcept {
+						D* d = *static_cast<D**>(storage);
+						_Call(p, *d);
+						delete d;
+					},
+					[](void* dst, void* src) noexcept { std::memcpy(dst, src, sizeof(D*)); },
+					[](void* storage) noexcept { delete *static_cast<D**>(storage); }
+				};
+			}
+		}
+
+		static constexpr _Any_deleter_vtable _Table = _Make();
+	};
+
+	//Owning pointer to an object of any type with any deleter. The deleter is type-erased into a
+	//pointer to a static table, so with stateless deleters the whole thing is two pointers.
+	//Stateful deleters live in a BufferSize-byte inline buffer when they fit and on the heap
+	//otherwise; BufferSize 0 accepts only stateless deleters.
+	template<std::size_t BufferSize>
+	class BasicAnyUniquePtr : private _Any_deleter_storage<BufferSize> {
+	public:
+		using pointer = void*;
+
+		BasicAnyUniquePtr(const BasicAnyUniquePtr&) = delete;
+		BasicAnyUniquePtr& operator=(const BasicAnyUniquePtr&) = delete;
+
+		constexpr BasicAnyUniquePtr() noexcept : _ptr(nullptr), _vt(nullptr) {}
+
+		constexpr BasicAnyUniquePtr(std::nullptr_t) noexcept : _ptr(nullptr), _vt(nullptr) {}
+
+		template<typename T>
+		requires (!std::is_void_v<T>)
+		explicit BasicAnyUniquePtr(T* p) noexcept : BasicAnyUniquePtr(p, _Default_delete_t<T>()) {}
+
+		//If boxing a stateful deleter throws, p is destroyed with d before the exception
+		//propagates, as std::shared_ptr(p, d) does.
+		template<typename T, typename D>
+		BasicAnyUniquePtr(T* p, D d) noexcept(_Any_deleter_stateless<D> || _Any_deleter_inline<D, BufferSize>) : _ptr(nullptr), _vt(nullptr) {
+			if constexpr (_Any_deleter_stateless<D> || _Any_deleter_inline<D, BufferSize>) {
+				_Emplace<T, D>(p, std::move(d));
+			}
+			else {
+				try {
+					_Emplace<T, D>(p, std::move(d));
+				}
+				catch (...) {
+					if (p) {
+						d(p);
+					}
+					throw;
+				}
+			}
+		}
+
+		template<typename T, typename D>
+		requires std::is_same_v<typename UniquePtr<T, D>::pointer, std::remove_extent_t<T>*> && (!std::is_reference_v<D>)
+		BasicAnyUniquePtr(UniquePtr<T, D>&& r) noexcept(_Any_deleter_stateless<D> || _Any_deleter_inline<D, BufferSize>) : _ptr(nullptr), _vt(nullptr) {
+			if (r) {
+				_Emplace<std::remove_extent_t<T>, D>(r.Get(), std::move(r.GetDeleter()));
+				r.Release();
+			}
+		}
+
+		BasicAnyUniquePtr(BasicAnyUniquePtr&& r) noexcept : _ptr(nullptr), _vt(nullptr) {
+			_Steal(r);
+		}
+
+		~BasicAnyUniquePtr() {
+			Reset();
+		}
+
+		BasicAnyUniquePtr& operator=(BasicAnyUniquePtr&& r) noexcept {
+			if (this != std::addressof(r)) {
+				Reset();
+				_Steal(r);
+			}
+			return *this;
+		}
+
+		BasicAnyUniquePtr& operator=(std::nullptr_t) noexcept {
+			Reset();
+			return *this;
+		}
+
+		void Reset() noexcept {
+			if (_ptr) {
+				void* p = std::exchange(_ptr, nullptr);
+				std::exchange(_vt, nullptr)->_destroy(p, this->_Storage());
+			}
+		}
+
+		//Gives up ownership without running the deleter, which is destroyed.
+		pointer Release() noexcept {
+			if (_vt && _vt->_discard) {
+				_vt->_discard(this->_Storage());
+			}
+			_vt = nullptr;
+			return std::exchange(_ptr, nullptr);
+		}
+
+		void Swap(BasicAnyUniquePtr& other) noexcept {
+			BasicAnyUniquePtr temp = std::move(other);
+			other = std::move(*this);
+			*this = std::move(temp);
+		}
+
+		pointer Get() const noexcept {
+			return _ptr;
+		}
+
+		template<typename T>
+		T* GetAs() const noexcept {
+			return static_cast<T*>(_ptr);
+		}
+
+		explicit operator bool() const noexcept {
+			return Get() != nullptr;
+		}
+
+	private:
+		template<typename T, typename D>
+		void _Emplace(T* p, D&& d) {
+			using deleter_type = std::remove_cvref_t<D>;
+			static_assert(_Any_deleter_stateless<deleter_type> || _Any_deleter_inline<deleter_type, BufferSize> || BufferSize >= sizeof(void*),
+				"stateful deleters need a BasicAnyUniquePtr buffer of at least one pointer");
+			if (!p) {
+				return;
+			}
+			if constexpr (_Any_deleter_inline<deleter_type, BufferSize>) {
+				::new (this->_Storage()) deleter_type(std::move(d));
+			}
+			else if constexpr (!_Any_deleter_stateless<deleter_type>) {
+				deleter_type* boxed = new deleter_type(std::move(d));
+				std::memcpy(this->_Storage(), &boxed, sizeof(boxed));
+			}
+			_ptr = const_cast<void*>(static_cast<const volatile void*>(p));
+			_vt = &_Any_deleter_ops<T, deleter_type, BufferSize>::_Table;
+		}
+
+		void _Steal(BasicAnyUniquePtr& r) noexcept {
+			if (r._vt && r._vt->_relocate) {
+				r._vt->_relocate(this->_Storage(), r._Storage());
+			}
+			_ptr = std::exchange(r._ptr, nullptr);
+			_vt = std::exchange(r._vt, nullptr);
+		}
+
+		void* _ptr;
+		const _Any_deleter_vtable* _vt;
+	};
+
+	using AnyUniquePtr = BasicAnyUniquePtr<0>;
+}
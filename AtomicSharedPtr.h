@@ -0,0 +1,160 @@
+#pragma once
+
+#include "SharedPtr.h"
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace Rainbow3D {
+
+	//Lock-free atomic SharedPtr using split reference counts. The control block pointer and a
+	//local count of in-flight loads share one word: Load() bumps the local count to pin the
+	//control block, takes a global reference and then gives the local one back. A store that
+	//replaces the control block first moves whatever local count it displaced into the global
+	//count, so readers that lost the race simply drop the extra global reference again. It holds
+	//SharedPtr<T> with the default SharedAtomicCount, whose count can be raised in bulk.
+	template<typename T>
+	class AtomicSharedPtr {
+	public:
+		using value_type = SharedPtr<T>;
+
+		constexpr AtomicSharedPtr() noexcept : _word(0) {}
+
+		AtomicSharedPtr(SharedPtr<T> desired) noexcept : _word(_Pack(_Take(desired), 0)) {}
+
+		AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+		AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+		~AtomicSharedPtr() {
+			if (auto rep = _Rep(_word.load(std::memory_order_acquire))) {
+				rep->_Decref({});
+			}
+		}
+
+		AtomicSharedPtr& operator=(SharedPtr<T> desired) noexcept {
+			Store(std::move(desired));
+			return *this;
+		}
+
+		operator SharedPtr<T>() const noexcept {
+			return Load();
+		}
+
+		SharedPtr<T> Load() const noexcept {
+			_Packed v = _word.fetch_add(_One, std::memory_order_acquire);
+			auto rep = _Rep(v);
+			if (rep) {
+				rep->_Incref({});
+			}
+			_Packed cur = v + _One;
+			bool surplus = false;
+			for (;;) {
+				if (_Rep(cur) != rep || _Count(cur) == 0) {
+					surplus = rep != nullptr;
+					break;
+				}
+				if (_word.compare_exchange_weak(cur, cur - _One, std::memory_order_release, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			//The result holds its own reference, so the surplus one can only be dropped after it is built.
+			SharedPtr<T> r = _Make(rep);
+			if (surplus) {
+				rep->_Decref({});
+			}
+			return r;
+		}
+
+		void Store(SharedPtr<T> desired) noexcept {
+			Exchange(std::move(desired));
+		}
+
+		SharedPtr<T> Exchange(SharedPtr<T> desired) noexcept {
+			_Packed old = _word.exchange(_Pack(_Take(desired), 0), std::memory_order_acq_rel);
+			return _Make(_Settle(old));
+		}
+
+		bool CompareExchange(SharedPtr<T>& expected, SharedPtr<T> desired) noexcept {
+			_Packed cur = _word.load(std::memory_order_relaxed);
+			for (;;) {
+				if (_Rep(cur) != expected._rep) {
+					SharedPtr<T> now = Load();
+					if (now._rep != expected._rep) {
+						expected = std::move(now);
+						return false;
+					}
+					cur = _word.load(std::memory_order_relaxed);
+					continue;
+				}
+				if (_word.compare_exchange_weak(cur, _Pack(desired._rep, 0), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+					_Take(desired);
+					if (auto rep = _Settle(cur)) {
+						rep->_Decref({});
+					}
+					return true;
+				}
+			}
+		}
+
+		bool IsLockFree() const noexcept {
+			return _word.is_lock_free();
+		}
+
+		static constexpr bool is_always_lock_free = std::atomic<std::uint64_t>::is_always_lock_free;
+
+	private:
+		using _Packed = std::uint64_t;
+		using _Rep_type = _Shared_control_block<T, SharedAtomicCount>;
+
+		//Pointers use the low 48 bits of the word (the canonical user-space range on x86-64 and
+		//AArch64); the remaining high bits hold the local count.
+		static constexpr unsigned int _Shift = sizeof(void*) == 8 ? 48 : 32;
+		static constexpr _Packed _One = _Packed(1) << _Shift;
+		static constexpr _Packed _Count_mask = ~(_One - 1);
+
+		//A control block above the 48-bit range (possible with 5-level paging) would be
+		//corrupted by the local count, so that layout is rejected rather than silently mangled.
+		static _Packed _Pack(_Rep_type* rep, _Packed count) noexcept {
+			_Packed bits = static_cast<_Packed>(reinterpret_cast<std::uintptr_t>(rep));
+			assert((bits & _Count_mask) == 0 && "control block address does not fit below the local count");
+			return bits | (count << _Shift);
+		}
+
+		static _Rep_type* _Rep(_Packed v) noexcept {
+			return reinterpret_cast<_Rep_type*>(static_cast<std::uintptr_t>(v & ~_Count_mask));
+		}
+
+		static _Packed _Count(_Packed v) noexcept {
+			return v >> _Shift;
+		}
+
+		static _Rep_type* _Take(SharedPtr<T>& p) noexcept {
+			p._ptr = nullptr;
+			return std::exchange(p._rep, nullptr);
+		}
+
+		static SharedPtr<T> _Make(_Rep_type* rep) noexcept {
+			SharedPtr<T> r;
+			if (rep) {
+				r._Adopt(rep);
+			}
+			return r;
+		}
+
+		//Moves the local count of a displaced word into its global count and returns the
+		//control block, whose reference previously owned by this object now belongs to the caller.
+		static _Rep_type* _Settle(_Packed old) noexcept {
+			auto rep = _Rep(old);
+			if (rep) {
+				if (_Packed count = _Count(old)) {
+					rep->Increment({}, static_cast<long>(count));
+				}
+			}
+			return rep;
+		}
+
+		mutable std::atomic<_Packed> _word;
+	};
+}
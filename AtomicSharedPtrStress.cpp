@@ -0,0 +1,122 @@
+//Stress test for AtomicSharedPtr. Build it standalone and run it under the sanitizers, e.g.
+//  c++ -std=c++20 -O1 -g -fsanitize=thread AtomicSharedPtrStress.cpp -o stress && ./stress
+//  c++ -std=c++20 -O1 -g -fsanitize=address,undefined AtomicSharedPtrStress.cpp -o stress && ./stress
+//Readers load the shared slot and check that the object they got is intact and still alive,
+//while writers replace it through Store, Exchange and CompareExchange. At the end every object
+//must have been destroyed exactly once.
+
+#include "AtomicSharedPtr.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	std::atomic<long> live{ 0 };
+	std::atomic<long> created{ 0 };
+
+	struct Value {
+		explicit Value(long id) : id(id), check(~id), alive(true) {
+			live.fetch_add(1, std::memory_order_relaxed);
+			created.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		~Value() {
+			if (!alive) {
+				std::fprintf(stderr, "value %ld destroyed twice\n", id);
+				std::abort();
+			}
+			alive = false;
+			live.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		void Verify() const {
+			if (!alive || check != ~id) {
+				std::fprintf(stderr, "read a dead or torn value\n");
+				std::abort();
+			}
+		}
+
+		long id;
+		long check;
+		bool alive;
+	};
+
+	void Require(bool ok, const char* what) {
+		if (!ok) {
+			std::fprintf(stderr, "check failed: %s\n", what);
+			std::abort();
+		}
+	}
+}
+
+int main() {
+	using namespace Rainbow3D;
+
+	constexpr int readers = 6;
+	constexpr int writers = 3;
+	constexpr int iterations = 200000;
+
+	{
+		AtomicSharedPtr<Value> slot(MakeShared<Value>(0));
+		std::atomic<bool> go{ false };
+		std::vector<std::thread> threads;
+
+		for (int r = 0; r < readers; ++r) {
+			threads.emplace_back([&] {
+				while (!go.load(std::memory_order_acquire)) {
+				}
+				for (int i = 0; i < iterations; ++i) {
+					SharedPtr<Value> v = slot.Load();
+					Require(v != nullptr, "slot is never empty");
+					v->Verify();
+					Require(v.UseCount() >= 1, "loaded value holds a reference");
+				}
+			});
+		}
+
+		for (int w = 0; w < writers; ++w) {
+			threads.emplace_back([&, w] {
+				while (!go.load(std::memory_order_acquire)) {
+				}
+				for (int i = 0; i < iterations / 4; ++i) {
+					long id = static_cast<long>(w) * iterations + i + 1;
+					switch (i % 3) {
+					case 0:
+						slot.Store(MakeShared<Value>(id));
+						break;
+					case 1: {
+						SharedPtr<Value> old = slot.Exchange(MakeShared<Value>(id));
+						Require(old != nullptr, "exchange returns the previous value");
+						old->Verify();
+						break;
+					}
+					default: {
+						SharedPtr<Value> expected = slot.Load();
+						SharedPtr<Value> desired = MakeShared<Value>(id);
+						while (!slot.CompareExchange(expected, desired)) {
+							expected->Verify();
+						}
+						break;
+					}
+					}
+				}
+			});
+		}
+
+		go.store(true, std::memory_order_release);
+		for (auto& t : threads) {
+			t.join();
+		}
+
+		SharedPtr<Value> last = slot.Load();
+		last->Verify();
+		Require(last.UseCount() == 2, "only the slot and this copy own the final value");
+	}
+
+	Require(live.load() == 0, "every value was destroyed");
+	std::printf("ok: %ld values created and destroyed\n", created.load());
+	return 0;
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "SharedPtr.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Rainbow3D {
+
+	struct BiasedCount;
+
+	//Per-thread owner record. Control blocks created on a thread point at its record; other
+	//threads queue objects here when their shared count goes negative so the owner can merge
+	//the biased count into the shared one.
+	struct _Biased_owner {
+		std::atomic<long> _refs{ 1 };
+		std::atomic<bool> _pending{ false };
+		std::mutex _mutex;
+		bool _alive = true;
+		std::vector<BiasedCount*> _queue;
+
+		void _Incref() noexcept {
+			_refs.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void _Decref() noexcept {
+			if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				delete this;
+			}
+		}
+
+		inline void _Drain() noexcept;
+	};
+
+	struct _Biased_thread_state {
+		_Biased_owner* _owner = new _Biased_owner;
+
+		inline ~_Biased_thread_state();
+	};
+
+	inline _Biased_owner* _Biased_current_owner() noexcept {
+		thread_local _Biased_thread_state state;
+		return state._owner;
+	}
+
+	//Biased reference count: the creating thread counts its references in a plain integer,
+	//every other thread uses the atomic shared count. The true count is the sum of both, so the
+	//shared count may go negative; the first time it does, the object is queued to its owner,
+	//which folds the biased count into the shared one ("merges") on its next pointer operation
+	//or when it exits. After merging all threads use the shared count and the object is freed
+	//when it reaches _Merged. Count policy for SharedPtr; see BiasedSharedPtr.
+	struct BiasedCount {
+		struct ticket_type {};
+
+		static ticket_type Ticket() noexcept {
+			return {};
+		}
+
+		static constexpr std::int64_t _Merged = std::int64_t(1) << 40;
+
+		std::atomic<_Biased_owner*> _owner;
+		//Only the owner writes _biased; it is atomic so that Count() on another thread is not a
+		//data race, and relaxed load/store pairs keep the owner's updates plain moves.
+		std::atomic<long> _biased{ 1 };
+		std::atomic<std::int64_t> _shared{ 0 };
+		bool _queued = false;
+
+		BiasedCount() noexcept : _owner(_Biased_current_owner()), _record(_owner.load(std::memory_order_relaxed)) {
+			_record->_Incref();
+		}
+
+		//Frees objects whose count reaches zero while their owner merges a queued count.
+		virtual void _Destroy() noexcept = 0;
+
+		void Increment(ticket_type) noexcept {
+			_Biased_owner* self = _Biased_current_owner();
+			if (_owner.load(std::memory_order_relaxed) == self) {
+				_biased.store(_biased.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				return;
+			}
+			_shared.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		//Returns true when the last reference is gone.
+		bool Decrement(ticket_type) noexcept {
+			_Biased_owner* self = _Biased_current_owner();
+			if (self->_pending.load(std::memory_order_relaxed)) {
+				self->_Drain();
+			}
+			if (_owner.load(std::memory_order_relaxed) == self) {
+				long biased = _biased.load(std::memory_order_relaxed) - 1;
+				_biased.store(biased, std::memory_order_relaxed);
+				if (biased == 0) {
+					std::unique_lock<std::mutex> lock(self->_mutex);
+					if (_queued) {
+						self->_queue.erase(std::find(self->_queue.begin(), self->_queue.end(), this));
+					}
+					_owner.store(nullptr, std::memory_order_relaxed);
+					lock.unlock();
+					return _shared.fetch_add(_Merged, std::memory_order_acq_rel) == 0;
+				}
+				return false;
+			}
+			std::int64_t v = _shared.load(std::memory_order_relaxed);
+			for (;;) {
+				if (v == 0) {
+					return _Decrement_slow();
+				}
+				if (_shared.compare_exchange_weak(v, v - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+					return v - 1 == _Merged;
+				}
+			}
+		}
+
+		//Non-owner decrement that may take the unmerged shared count negative. Runs under the
+		//owner's lock so the object cannot be merged and freed while it is being queued.
+		bool _Decrement_slow() noexcept {
+			_Biased_owner* record = _record;
+			record->_Incref();
+			std::unique_lock<std::mutex> lock(record->_mutex);
+			std::int64_t now = _shared.fetch_sub(1, std::memory_order_acq_rel) - 1;
+			bool dead = now == _Merged;
+			if (now == -1 && _owner.load(std::memory_order_relaxed) && !_queued) {
+				if (record->_alive) {
+					_queued = true;
+					record->_queue.push_back(this);
+					record->_pending.store(true, std::memory_order_release);
+				}
+				else {
+					dead = _Merge();
+				}
+			}
+			lock.unlock();
+			record->_Decref();
+			return dead;
+		}
+
+		//Folds the biased count into the shared count; returns true if the object is now dead.
+		bool _Merge() noexcept {
+			_owner.store(nullptr, std::memory_order_relaxed);
+			std::int64_t add = _Merged + _biased.load(std::memory_order_relaxed);
+			return _shared.fetch_add(add, std::memory_order_acq_rel) + add == _Merged;
+		}
+
+		//Approximate unless called on the owner thread or after the count has been merged.
+		long Count() const noexcept {
+			std::int64_t shared = _shared.load(std::memory_order_relaxed);
+			if (_owner.load(std::memory_order_relaxed) != nullptr) {
+				return static_cast<long>(shared + _biased.load(std::memory_order_relaxed));
+			}
+			return static_cast<long>(shared - _Merged);
+		}
+
+	protected:
+		~BiasedCount() {
+			_record->_Decref();
+		}
+
+	private:
+		_Biased_owner* _record;
+	};
+
+	inline void _Biased_owner::_Drain() noexcept {
+		std::unique_lock<std::mutex> lock(_mutex);
+		std::vector<BiasedCount*> queue = std::move(_queue);
+		_queue.clear();
+		_pending.store(false, std::memory_order_relaxed);
+		std::vector<BiasedCount*> dead;
+		for (auto rep : queue) {
+			rep->_queued = false;
+			if (rep->_Merge()) {
+				dead.push_back(rep);
+			}
+		}
+		lock.unlock();
+		for (auto rep : dead) {
+			rep->_Destroy();
+		}
+	}
+
+	inline _Biased_thread_state::~_Biased_thread_state() {
+		{
+			std::lock_guard<std::mutex> lock(_owner->_mutex);
+			_owner->_alive = false;
+		}
+		_owner->_Drain();
+		_owner->_Decref();
+	}
+
+	//Merges the counts of objects created on this thread that other threads have queued. Owners
+	//do this on their own pointer operations and when they exit; long-lived owner threads that
+	//stop touching biased pointers can call it at a safe point instead.
+	inline void MergeBiasedCounts() noexcept {
+		_Biased_owner* self = _Biased_current_owner();
+		if (self->_pending.load(std::memory_order_relaxed)) {
+			self->_Drain();
+		}
+	}
+
+	//SharedPtr with biased reference counting: copies and destructions on the creating thread
+	//are non-atomic, other threads pay one atomic RMW as usual.
+	template<typename T>
+	using BiasedSharedPtr = SharedPtr<T, BiasedCount>;
+
+	template<typename T, typename... Args>
+	BiasedSharedPtr<T> MakeBiasedShared(Args&&... args) {
+		return MakeShared<T, BiasedCount>(std::forward<Args>(args)...);
+	}
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace Rainbow3D {
+
+	//Arena with a fixed base address, as required by CompressedUniquePtr:
+	//  static unsigned char* Base() noexcept;
+	//  static void* Allocate(std::size_t bytes, std::size_t align);
+	//  static void Deallocate(void* p, std::size_t bytes, std::size_t align) noexcept;
+	template<typename Arena>
+	concept CompressionArena = requires(void* p, std::size_t n) {
+		{ Arena::Base() } noexcept -> std::same_as<unsigned char*>;
+		{ Arena::Allocate(n, n) } -> std::same_as<void*>;
+		{ Arena::Deallocate(p, n, n) } noexcept;
+	};
+
+	//Bump arena over one region reserved by Initialize(). Deallocate is a no-op; memory comes back
+	//all at once through Rewind() (once every object in it is gone) or Shutdown(). Tag separates
+	//independent arenas of the same shape.
+	template<typename Tag>
+	class CompressedBumpArena {
+	public:
+		static void Initialize(std::size_t capacity) {
+			if (_base) {
+				throw std::logic_error("CompressedBumpArena is already initialized");
+			}
+			_base = static_cast<unsigned char*>(::operator new(capacity, std::align_val_t(_Region_align)));
+			_capacity = capacity;
+			_used.store(0, std::memory_order_relaxed);
+		}
+
+		static void Shutdown() noexcept {
+			if (_base) {
+				::operator delete(std::exchange(_base, nullptr), std::align_val_t(_Region_align));
+				_capacity = 0;
+				_used.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		static void Rewind() noexcept {
+			_used.store(0, std::memory_order_relaxed);
+		}
+
+		static unsigned char* Base() noexcept {
+			return _base;
+		}
+
+		static void* Allocate(std::size_t bytes, std::size_t align) {
+			std::size_t used = _used.load(std::memory_order_relaxed);
+			std::size_t offset;
+			do {
+				offset = (used + align - 1) & ~(align - 1);
+				if (offset + bytes > _capacity) {
+					throw std::bad_alloc();
+				}
+			} while (!_used.compare_exchange_weak(used, offset + bytes, std::memory_order_relaxed));
+			return _base + offset;
+		}
+
+		static void Deallocate(void*, std::size_t, std::size_t) noexcept {}
+
+		static std::size_t Used() noexcept {
+			return _used.load(std::memory_order_relaxed);
+		}
+
+	private:
+		static constexpr std::size_t _Region_align = 4096;
+
+		static inline unsigned char* _base = nullptr;
+		static inline std::size_t _capacity = 0;
+		static inline std::atomic<std::size_t> _used{ 0 };
+	};
+
+	//Owning pointer stored as a 32-bit offset from Arena::Base(), counted in units of alignof(T)
+	//so one arena can span 4 GB times the alignment. Zero encodes null, so offsets are stored +1.
+	//The object is destroyed as exactly T and its memory returned to Arena; there is no deleter
+	//and no polymorphic deletion.
+	template<typename T, typename Arena>
+	class CompressedUniquePtr {
+		static_assert(!std::is_array_v<T>, "CompressedUniquePtr does not support arrays");
+
+	public:
+		using element_type = T;
+		using pointer = T*;
+		using arena_type = Arena;
+		using offset_type = std::uint32_t;
+
+		constexpr CompressedUniquePtr() noexcept : _offset(0) {}
+
+		constexpr CompressedUniquePtr(std::nullptr_t) noexcept : _offset(0) {}
+
+		//p must have been allocated from Arena. If it lies beyond the range an offset can encode,
+		//it is destroyed and returned to Arena before std::out_of_range propagates.
+		explicit CompressedUniquePtr(pointer p) : _offset(_Compress_or_destroy(p)) {}
+
+		CompressedUniquePtr(const CompressedUniquePtr&) = delete;
+		CompressedUniquePtr& operator=(const CompressedUniquePtr&) = delete;
+
+		CompressedUniquePtr(CompressedUniquePtr&& r) noexcept : _offset(std::exchange(r._offset, 0)) {}
+
+		~CompressedUniquePtr() {
+			_Destroy(_offset);
+		}
+
+		CompressedUniquePtr& operator=(CompressedUniquePtr&& r) noexcept {
+			if (this != std::addressof(r)) {
+				_Destroy(std::exchange(_offset, std::exchange(r._offset, 0)));
+			}
+			return *this;
+		}
+
+		CompressedUniquePtr& operator=(std::nullptr_t) noexcept {
+			Reset();
+			return *this;
+		}
+
+		pointer Release() noexcept {
+			return _Decompress(std::exchange(_offset, 0));
+		}
+
+		void Reset() noexcept {
+			_Destroy(std::exchange(_offset, 0));
+		}
+
+		void Reset(pointer p) {
+			_Destroy(std::exchange(_offset, _Compress_or_destroy(p)));
+		}
+
+		void Swap(CompressedUniquePtr& other) noexcept {
+			std::swap(_offset, other._offset);
+		}
+
+		pointer Get() const noexcept {
+			return _Decompress(_offset);
+		}
+
+		offset_type GetOffset() const noexcept {
+			return _offset;
+		}
+
+		explicit operator bool() const noexcept {
+			return _offset != 0;
+		}
+
+		pointer operator->() const noexcept {
+			return Get();
+		}
+
+		T& operator*() const noexcept {
+			return *Get();
+		}
+
+	private:
+		template<typename U, typename A, typename... Args>
+		requires CompressionArena<A>
+		friend CompressedUniquePtr<U, A> MakeCompressedUnique(Args&&... args);
+
+		struct _Offset_tag {};
+
+		constexpr CompressedUniquePtr(_Offset_tag, offset_type offset) noexcept : _offset(offset) {}
+
+		static offset_type _Compress(const void* p) {
+			if (!p) {
+				return 0;
+			}
+			std::size_t units = static_cast<std::size_t>(static_cast<const unsigned char*>(p) - Arena::Base()) / alignof(T);
+			if (units >= 0xFFFFFFFFu) {
+				throw std::out_of_range("pointer is outside the range CompressedUniquePtr can encode");
+			}
+			return static_cast<offset_type>(units + 1);
+		}
+
+		static offset_type _Compress_or_destroy(pointer p) {
+			try {
+				return _Compress(p);
+			}
+			catch (...) {
+				p->~T();
+				Arena::Deallocate(p, sizeof(T), alignof(T));
+				throw;
+			}
+		}
+
+		static pointer _Decompress(offset_type offset) noexcept {
+			if (offset == 0) {
+				return nullptr;
+			}
+			return reinterpret_cast<pointer>(Arena::Base() + static_cast<std::size_t>(offset - 1) * alignof(T));
+		}
+
+		static void _Destroy(offset_type offset) noexcept {
+			if (offset) {
+				pointer p = _Decompress(offset);
+				p->~T();
+				Arena::Deallocate(p, sizeof(T), alignof(T));
+			}
+		}
+
+		offset_type _offset;
+	};
+
+	template<typename T, typename Arena, typename... Args>
+	requires CompressionArena<Arena>
+	CompressedUniquePtr<T, Arena> MakeCompressedUnique(Args&&... args) {
+		using _Ptr = CompressedUniquePtr<T, Arena>;
+		void* mem = Arena::Allocate(sizeof(T), alignof(T));
+		//Encoded before T is built, so an unencodable block never holds a live object.
+		typename _Ptr::offset_type offset;
+		try {
+			offset = _Ptr::_Compress(mem);
+			::new (mem) T(std::forward<Args>(args)...);
+		}
+		catch (...) {
+			Arena::Deallocate(mem, sizeof(T), alignof(T));
+			throw;
+		}
+		return _Ptr(typename _Ptr::_Offset_tag{}, offset);
+	}
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace Rainbow3D {
+
+	//Reference count for CowPtr instances shared across threads.
+	struct CowAtomicCount {
+		std::atomic<long> _uses{ 1 };
+
+		void Increment() noexcept {
+			_uses.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		//Returns true when the last reference is gone.
+		bool Decrement() noexcept {
+			return _uses.fetch_sub(1, std::memory_order_acq_rel) == 1;
+		}
+
+		bool Unique() const noexcept {
+			return _uses.load(std::memory_order_acquire) == 1;
+		}
+
+		long Count() const noexcept {
+			return _uses.load(std::memory_order_relaxed);
+		}
+	};
+
+	//Reference count for CowPtr instances that never leave one thread.
+	struct CowLocalCount {
+		long _uses = 1;
+
+		void Increment() noexcept {
+			++_uses;
+		}
+
+		bool Decrement() noexcept {
+			return --_uses == 0;
+		}
+
+		bool Unique() const noexcept {
+			return _uses == 1;
+		}
+
+		long Count() const noexcept {
+			return _uses;
+		}
+	};
+
+	template<typename T, typename CountPolicy>
+	struct _Cow_node {
+		template<typename... Args>
+		explicit _Cow_node(std::in_place_t, Args&&... args) : _value(std::forward<Args>(args)...) {}
+
+		CountPolicy _count;
+		T _value;
+	};
+
+	//Copy-on-write pointer. Copies share one immutable T until one of them asks for mutable
+	//access through Write(), which clones the value first if anyone else still shares it.
+	//Reads never copy. The count is atomic by default; CowLocalCount drops the atomics for
+	//instances confined to one thread.
+	template<typename T, typename CountPolicy = CowAtomicCount>
+	class CowPtr {
+	public:
+		using element_type = T;
+
+		constexpr CowPtr() noexcept : _node(nullptr) {}
+
+		constexpr CowPtr(std::nullptr_t) noexcept : _node(nullptr) {}
+
+		template<typename... Args>
+		explicit CowPtr(std::in_place_t, Args&&... args) : _node(new _Node(std::in_place, std::forward<Args>(args)...)) {}
+
+		CowPtr(const CowPtr& r) noexcept : _node(r._node) {
+			if (_node) {
+				_node->_count.Increment();
+			}
+		}
+
+		CowPtr(CowPtr&& r) noexcept : _node(std::exchange(r._node, nullptr)) {}
+
+		~CowPtr() {
+			_Release();
+		}
+
+		CowPtr& operator=(const CowPtr& r) noexcept {
+			CowPtr(r).Swap(*this);
+			return *this;
+		}
+
+		CowPtr& operator=(CowPtr&& r) noexcept {
+			CowPtr(std::move(r)).Swap(*this);
+			return *this;
+		}
+
+		CowPtr& operator=(std::nullptr_t) noexcept {
+			Reset();
+			return *this;
+		}
+
+		void Reset() noexcept {
+			_Release();
+			_node = nullptr;
+		}
+
+		void Swap(CowPtr& other) noexcept {
+			std::swap(_node, other._node);
+		}
+
+		const T* Get() const noexcept {
+			return _node ? &_node->_value : nullptr;
+		}
+
+		//Returns the value for mutation, cloning it first if it is shared.
+		T& Write() {
+			if (!_node->_count.Unique()) {
+				_Node* copy = new _Node(std::in_place, static_cast<const T&>(_node->_value));
+				_Release();
+				_node = copy;
+			}
+			return _node->_value;
+		}
+
+		bool IsUnique() const noexcept {
+			return _node && _node->_count.Unique();
+		}
+
+		long UseCount() const noexcept {
+			return _node ? _node->_count.Count() : 0;
+		}
+
+		explicit operator bool() const noexcept {
+			return _node != nullptr;
+		}
+
+		const T* operator->() const noexcept {
+			return &_node->_value;
+		}
+
+		const T& operator*() const noexcept {
+			return _node->_value;
+		}
+
+	private:
+		using _Node = _Cow_node<T, CountPolicy>;
+
+		void _Release() noexcept {
+			if (_node && _node->_count.Decrement()) {
+				delete _node;
+			}
+		}
+
+		_Node* _node;
+	};
+
+	template<typename T, typename CountPolicy = CowAtomicCount, typename... Args>
+	CowPtr<T, CountPolicy> MakeCow(Args&&... args) {
+		return CowPtr<T, CountPolicy>(std::in_place, std::forward<Args>(args)...);
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <ranges>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define RAINBOW3D_PREFETCH(p) _mm_prefetch(reinterpret_cast<const char*>(p), _MM_HINT_T0)
+#else
+#define RAINBOW3D_PREFETCH(p) __builtin_prefetch(p)
+#endif
+
+namespace Rainbow3D {
+
+	//A deleter with a batch hook, called once with every pointer of a DestroyAll pass (sorted by
+	//address, none null) so it can destroy them and return the memory in bulk.
+	template<typename D, typename P>
+	concept BatchDeleter = requires(D d, P const* ptrs, std::size_t n) {
+		d.DeleteBatch(ptrs, n);
+	};
+
+	//How far ahead of the object being destroyed DestroyAll prefetches.
+	inline constexpr std::size_t _Destroy_all_prefetch = 8;
+
+	//Destroys every object owned by a range of owning pointers (UniquePtr or anything with
+	//Release() and a deleter_type), leaving the elements null. With a stateless deleter the
+	//pointers are first released and sorted by address, so destruction walks memory in order
+	//with prefetching ahead of it, and the whole batch goes to the deleter's DeleteBatch hook
+	//when it has one. Deleters with state stay attached to their element, so those ranges are
+	//simply reset front to back.
+	template<std::ranges::forward_range R>
+	void DestroyAll(R&& range) {
+		using _Ptr = std::ranges::range_value_t<R>;
+		using _Deleter = typename _Ptr::deleter_type;
+		using _Pointer = typename _Ptr::pointer;
+		if constexpr (std::is_empty_v<_Deleter> && std::is_default_constructible_v<_Deleter> && std::is_pointer_v<_Pointer>) {
+			std::vector<_Pointer> ptrs;
+			if constexpr (std::ranges::sized_range<R>) {
+				ptrs.reserve(static_cast<std::size_t>(std::ranges::size(range)));
+			}
+			//Collect first and release after, so a failed allocation leaves the range owning everything.
+			for (auto& p : range) {
+				if (p) {
+					ptrs.push_back(p.Get());
+				}
+			}
+			for (auto& p : range) {
+				p.Release();
+			}
+			std::sort(ptrs.begin(), ptrs.end(), std::less<_Pointer>());
+			_Deleter d{};
+			if constexpr (BatchDeleter<_Deleter, _Pointer>) {
+				d.DeleteBatch(ptrs.data(), ptrs.size());
+			}
+			else {
+				std::size_t n = ptrs.size();
+				for (std::size_t i = 0; i < n; ++i) {
+					if (i + _Destroy_all_prefetch < n) {
+						RAINBOW3D_PREFETCH(ptrs[i + _Destroy_all_prefetch]);
+					}
+					d(ptrs[i]);
+				}
+			}
+		}
+		else {
+			for (auto& p : range) {
+				p.Reset();
+			}
+		}
+	}
+}
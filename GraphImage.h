@@ -0,0 +1,317 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Rainbow3D {
+
+	//Contiguous, 16-byte aligned byte buffer holding a serialized graph. Write Data()/Size() out
+	//as is; to load, Allocate() a buffer of the stored size and read the bytes into Data().
+	class GraphImage {
+	public:
+		static constexpr std::size_t alignment = 16;
+
+		GraphImage() noexcept : _data(nullptr), _size(0) {}
+
+		GraphImage(const GraphImage&) = delete;
+		GraphImage& operator=(const GraphImage&) = delete;
+
+		GraphImage(GraphImage&& r) noexcept : _data(std::exchange(r._data, nullptr)), _size(std::exchange(r._size, 0)) {}
+
+		GraphImage& operator=(GraphImage&& r) noexcept {
+			if (this != &r) {
+				_Free();
+				_data = std::exchange(r._data, nullptr);
+				_size = std::exchange(r._size, 0);
+			}
+			return *this;
+		}
+
+		~GraphImage() {
+			_Free();
+		}
+
+		static GraphImage Allocate(std::size_t size) {
+			GraphImage image;
+			image._data = static_cast<unsigned char*>(::operator new(size, std::align_val_t(alignment)));
+			image._size = size;
+			return image;
+		}
+
+		unsigned char* Data() const noexcept {
+			return _data;
+		}
+
+		std::size_t Size() const noexcept {
+			return _size;
+		}
+
+	private:
+		void _Free() noexcept {
+			if (_data) {
+				::operator delete(_data, std::align_val_t(alignment));
+			}
+		}
+
+		unsigned char* _data;
+		std::size_t _size;
+	};
+
+	//Image layout: header, node bytes, relocation table. Every pointer field in the node bytes
+	//holds the image offset of its target (0 for null), and the relocation table lists the image
+	//offsets of those fields, in the order they were written.
+	struct _Graph_image_header {
+		std::uint64_t _magic;
+		std::uint64_t _node_end;
+		std::uint64_t _reloc_count;
+		std::uint64_t _root;
+	};
+
+	inline constexpr std::uint64_t _Graph_image_magic = 0x5233444752415048ull;
+
+	//A UniquePtr link that can be swizzled: one pointer word, no deleter state.
+	template<typename U, typename D>
+	concept _Swizzlable_link = std::is_empty_v<D> && std::is_same_v<typename UniquePtr<U, D>::pointer, U*> && sizeof(UniquePtr<U, D>) == sizeof(U*);
+
+	class _Graph_writer {
+	public:
+		struct _Item {
+			const void* _src;
+			std::uint64_t _dst;
+			void (*_process)(_Graph_writer&, const void*, std::uint64_t);
+		};
+
+		_Graph_writer() : _bytes(sizeof(_Graph_image_header)) {}
+
+		std::uint64_t _Place(const void* src, std::size_t size, std::size_t align) {
+			if (align > GraphImage::alignment) {
+				throw std::invalid_argument("graph nodes are limited to 16-byte alignment");
+			}
+			std::size_t offset = (_bytes.size() + align - 1) & ~(align - 1);
+			_bytes.resize(offset + size);
+			std::memcpy(_bytes.data() + offset, src, size);
+			return offset;
+		}
+
+		void _Link(std::uint64_t field, std::uint64_t target) {
+			std::uintptr_t value = static_cast<std::uintptr_t>(target);
+			std::memcpy(_bytes.data() + field, &value, sizeof(value));
+			if (target) {
+				_relocs.push_back(field);
+			}
+		}
+
+		std::vector<unsigned char> _bytes;
+		std::vector<std::uint64_t> _relocs;
+		std::vector<_Item> _work;
+	};
+
+	template<typename T>
+	void _Graph_process(_Graph_writer& w, const void* src, std::uint64_t dst) {
+		T& node = *static_cast<T*>(const_cast<void*>(src));
+		node.Visit([&]<typename U, typename D>(UniquePtr<U, D>& child) {
+			static_assert(_Swizzlable_link<U, D>, "graph links need an empty deleter and a raw pointer");
+			static_assert(!std::is_polymorphic_v<U>, "graph nodes cannot hold vtable pointers");
+			std::size_t field = static_cast<std::size_t>(reinterpret_cast<unsigned char*>(&child) - reinterpret_cast<unsigned char*>(&node));
+			if (field + sizeof(U*) > sizeof(T)) {
+				throw std::invalid_argument("Visit has to pass the node's own members");
+			}
+			std::uint64_t target = 0;
+			if (U* p = child.Get()) {
+				target = w._Place(p, sizeof(U), alignof(U));
+				w._work.push_back({ p, target, &_Graph_process<U> });
+			}
+			w._Link(dst + field, target);
+		});
+	}
+
+	//Writes the graph owned by root into one image. Node types describe their links with
+	//  template<typename V> void Visit(V&& v) { v(left); v(right); }
+	//passing each UniquePtr member that owns a child. Everything else in a node is copied
+	//bytewise, so nodes must be trivially copyable apart from those links. The walk uses an
+	//explicit worklist and handles arbitrarily deep graphs.
+	template<typename T, typename D>
+	requires _Swizzlable_link<T, D>
+	GraphImage SerializeGraph(const UniquePtr<T, D>& root) {
+		static_assert(!std::is_polymorphic_v<T>, "graph nodes cannot hold vtable pointers");
+		_Graph_writer w;
+		std::uint64_t root_offset = 0;
+		if (T* p = root.Get()) {
+			root_offset = w._Place(p, sizeof(T), alignof(T));
+			w._work.push_back({ p, root_offset, &_Graph_process<T> });
+		}
+		while (!w._work.empty()) {
+			_Graph_writer::_Item item = w._work.back();
+			w._work.pop_back();
+			item._process(w, item._src, item._dst);
+		}
+		std::size_t node_end = (w._bytes.size() + alignof(std::uint64_t) - 1) & ~(alignof(std::uint64_t) - 1);
+		GraphImage image = GraphImage::Allocate(node_end + w._relocs.size() * sizeof(std::uint64_t));
+		_Graph_image_header header{ _Graph_image_magic, node_end, w._relocs.size(), root_offset };
+		std::memcpy(w._bytes.data(), &header, sizeof(header));
+		std::memcpy(image.Data(), w._bytes.data(), w._bytes.size());
+		std::memset(image.Data() + w._bytes.size(), 0, node_end - w._bytes.size());
+		if (!w._relocs.empty()) {
+			std::memcpy(image.Data() + node_end, w._relocs.data(), w._relocs.size() * sizeof(std::uint64_t));
+		}
+		return image;
+	}
+
+	//Graph living inside a loaded image. The links are real UniquePtrs pointing into the image,
+	//so the nodes are used exactly like the graph that was saved; they must not be Reset or
+	//Released, since the image owns the memory. On destruction every relocated link is nulled
+	//before the image is freed, so no deleter ever runs on image memory.
+	template<typename T>
+	class LoadedGraph {
+	public:
+		LoadedGraph() noexcept : _root(nullptr) {}
+
+		LoadedGraph(const LoadedGraph&) = delete;
+		LoadedGraph& operator=(const LoadedGraph&) = delete;
+
+		LoadedGraph(LoadedGraph&& r) noexcept : _image(std::move(r._image)), _root(std::exchange(r._root, nullptr)) {}
+
+		LoadedGraph& operator=(LoadedGraph&& r) noexcept {
+			if (this != &r) {
+				_Unlink();
+				_image = std::move(r._image);
+				_root = std::exchange(r._root, nullptr);
+			}
+			return *this;
+		}
+
+		~LoadedGraph() {
+			_Unlink();
+		}
+
+		T* Root() const noexcept {
+			return _root;
+		}
+
+		T* operator->() const noexcept {
+			return _root;
+		}
+
+		T& operator*() const noexcept {
+			return *_root;
+		}
+
+	private:
+		template<typename U>
+		friend LoadedGraph<U> LoadGraph(GraphImage image);
+
+		void _Unlink() noexcept {
+			if (!_image.Data()) {
+				return;
+			}
+			_Graph_image_header header;
+			std::memcpy(&header, _image.Data(), sizeof(header));
+			const unsigned char* relocs = _image.Data() + header._node_end;
+			for (std::uint64_t i = 0; i < header._reloc_count; ++i) {
+				std::uint64_t field;
+				std::memcpy(&field, relocs + i * sizeof(field), sizeof(field));
+				std::memset(_image.Data() + field, 0, sizeof(void*));
+			}
+			_image = GraphImage();
+			_root = nullptr;
+		}
+
+		GraphImage _image;
+		T* _root;
+	};
+
+	//Checks a loaded graph with the node types the image is supposed to hold: every reachable
+	//node has to lie past the header, be aligned for its type and fit before the relocation
+	//table. At most one node per relocation is visited, so a cyclic image cannot hang the walk.
+	struct _Graph_verifier {
+		struct _Item {
+			void* _node;
+			void (*_verify)(_Graph_verifier&, void*);
+		};
+
+		template<typename U>
+		bool _Fits(const void* p) const noexcept {
+			std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(p);
+			std::uintptr_t base = reinterpret_cast<std::uintptr_t>(_base);
+			if (addr < base) {
+				return false;
+			}
+			std::uint64_t offset = addr - base;
+			return offset >= sizeof(_Graph_image_header) && offset % alignof(U) == 0 && offset <= _node_end && sizeof(U) <= _node_end - offset;
+		}
+
+		const unsigned char* _base;
+		std::uint64_t _node_end;
+		std::uint64_t _budget;
+		std::vector<_Item> _work;
+	};
+
+	template<typename T>
+	void _Graph_verify(_Graph_verifier& v, void* node) {
+		static_cast<T*>(node)->Visit([&]<typename U, typename D>(UniquePtr<U, D>& child) {
+			if (U* p = child.Get()) {
+				if (v._budget == 0 || !v.template _Fits<U>(p)) {
+					throw std::invalid_argument("corrupt graph image");
+				}
+				--v._budget;
+				v._work.push_back({ p, &_Graph_verify<U> });
+			}
+		});
+	}
+
+	//Unswizzles image in place with one linear pass over its relocation table, checks the result
+	//with one walk over the nodes, and takes it over. T must be the root type the image was
+	//serialized from.
+	template<typename T>
+	LoadedGraph<T> LoadGraph(GraphImage image) {
+		_Graph_image_header header;
+		if (image.Size() < sizeof(header)) {
+			throw std::invalid_argument("not a graph image");
+		}
+		std::memcpy(&header, image.Data(), sizeof(header));
+		if (header._magic != _Graph_image_magic || header._node_end > image.Size() || header._reloc_count > (image.Size() - header._node_end) / sizeof(std::uint64_t)) {
+			throw std::invalid_argument("not a graph image");
+		}
+		unsigned char* base = image.Data();
+		const unsigned char* relocs = base + header._node_end;
+		for (std::uint64_t i = 0; i < header._reloc_count; ++i) {
+			std::uint64_t field;
+			std::uintptr_t target;
+			std::memcpy(&field, relocs + i * sizeof(field), sizeof(field));
+			if (field < sizeof(header) || field % alignof(void*) != 0 || field + sizeof(void*) > header._node_end) {
+				throw std::invalid_argument("corrupt graph image");
+			}
+			std::memcpy(&target, base + field, sizeof(target));
+			if (target < sizeof(header) || target >= header._node_end) {
+				throw std::invalid_argument("corrupt graph image");
+			}
+			unsigned char* p = base + target;
+			std::memcpy(base + field, &p, sizeof(p));
+		}
+		T* root = header._root ? reinterpret_cast<T*>(base + header._root) : nullptr;
+		if (root) {
+			_Graph_verifier v{ base, header._node_end, header._reloc_count, {} };
+			if (!v._Fits<T>(root)) {
+				throw std::invalid_argument("corrupt graph image");
+			}
+			v._work.push_back({ root, &_Graph_verify<T> });
+			while (!v._work.empty()) {
+				_Graph_verifier::_Item item = v._work.back();
+				v._work.pop_back();
+				item._verify(v, item._node);
+			}
+		}
+		LoadedGraph<T> graph;
+		graph._image = std::move(image);
+		graph._root = root;
+		return graph;
+	}
+}
@@ -0,0 +1,350 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Rainbow3D {
+
+	inline constexpr unsigned _Hazard_free = 0;
+	inline constexpr unsigned _Hazard_owned = 1;
+	inline constexpr unsigned _Hazard_orphaned = 2;
+
+	//One hazard slot. _state says whether a thread owns the record, and becomes _Hazard_orphaned
+	//when the domain dies while a thread still caches it; that thread then frees it. _cached_next
+	//links the owning thread's idle records and is only touched by that thread.
+	struct alignas(64) _Hazard_record {
+		std::atomic<void*> _hazard{ nullptr };
+		std::atomic<unsigned> _state{ _Hazard_free };
+		_Hazard_record* _next = nullptr;
+		_Hazard_record* _cached_next = nullptr;
+	};
+
+	//Hands a cached record back to its domain, or frees it if the domain is already gone.
+	inline void _Hazard_disown(_Hazard_record* rec) noexcept {
+		unsigned state = _Hazard_owned;
+		if (!rec->_state.compare_exchange_strong(state, _Hazard_free, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			delete rec;
+		}
+	}
+
+	//Idle records the calling thread keeps for the last few domains it used, so Protect() on a
+	//warm thread touches no shared state besides its own hazard slot. Trivially destructible, so
+	//guards held by other thread_local objects can still be released after _Hazard_thread_exit
+	//has handed the records back; from then on records go straight back to their domain.
+	struct _Hazard_thread_cache {
+		static constexpr std::size_t _Domains = 4;
+
+		struct _Entry {
+			std::uint64_t _domain;
+			_Hazard_record* _free;
+		};
+
+		_Entry* _Find(std::uint64_t domain) noexcept {
+			if (_exited) {
+				return nullptr;
+			}
+			_Entry* empty = nullptr;
+			for (_Entry& e : _entries) {
+				if (e._domain == domain) {
+					return &e;
+				}
+				if (!e._domain && !empty) {
+					empty = &e;
+				}
+			}
+			if (!empty) {
+				empty = &_entries[_evict++ % _Domains];
+				_Flush(*empty);
+			}
+			empty->_domain = domain;
+			return empty;
+		}
+
+		void _Flush(_Entry& e) noexcept {
+			while (_Hazard_record* rec = e._free) {
+				e._free = rec->_cached_next;
+				_Hazard_disown(rec);
+			}
+			e._domain = 0;
+		}
+
+		_Entry _entries[_Domains];
+		std::size_t _evict;
+		bool _exited;
+	};
+
+	struct _Hazard_thread_exit {
+		_Hazard_thread_cache* _cache;
+
+		~_Hazard_thread_exit() {
+			for (auto& e : _cache->_entries) {
+				_cache->_Flush(e);
+			}
+			_cache->_exited = true;
+		}
+	};
+
+	inline _Hazard_thread_cache& _Hazard_thread() noexcept {
+		thread_local _Hazard_thread_cache cache{};
+		thread_local _Hazard_thread_exit exit{ &cache };
+		return cache;
+	}
+
+	struct _Retired_node {
+		void* _ptr;
+		void (*_reclaim)(void*);
+	};
+
+	template<typename T>
+	class HazardGuard;
+
+	//Hazard pointer domain. Readers publish the pointer they are about to use in a hazard slot,
+	//writers retire objects instead of deleting them, and a scan frees every retired object that
+	//no slot protects once the retired list reaches the threshold. A stalled reader pins at most
+	//the objects it protects, so the retired list never grows past threshold + slot count.
+	//Each thread keeps the slots it has used in a thread_local cache, one slot per guard it holds
+	//at once; after the first Protect() on a thread, Protect() is one store and one reload of
+	//the source, and releasing a guard is one store.
+	class HazardPointerDomain {
+	public:
+		explicit HazardPointerDomain(std::size_t threshold = 64) noexcept : _id(_Next_id()), _threshold(threshold) {}
+
+		HazardPointerDomain(const HazardPointerDomain&) = delete;
+		HazardPointerDomain& operator=(const HazardPointerDomain&) = delete;
+
+		//All guards must have been destroyed before the domain. Slots still cached by running
+		//threads are left to those threads, which free them when they exit.
+		~HazardPointerDomain() {
+			for (auto& r : _retired) {
+				r._reclaim(r._ptr);
+			}
+			_Hazard_record* rec = _head.load(std::memory_order_acquire);
+			while (rec) {
+				_Hazard_record* next = rec->_next;
+				unsigned state = _Hazard_owned;
+				if (!rec->_state.compare_exchange_strong(state, _Hazard_orphaned, std::memory_order_acq_rel, std::memory_order_acquire)) {
+					delete rec;
+				}
+				rec = next;
+			}
+		}
+
+		static HazardPointerDomain& Default() noexcept {
+			static HazardPointerDomain domain;
+			return domain;
+		}
+
+		template<typename T>
+		HazardGuard<T> Protect(const std::atomic<T*>& src) {
+			_Hazard_record* rec = _Acquire();
+			T* p = src.load(std::memory_order_relaxed);
+			for (;;) {
+				rec->_hazard.store(p, std::memory_order_seq_cst);
+				T* q = src.load(std::memory_order_seq_cst);
+				if (p == q) {
+					break;
+				}
+				p = q;
+			}
+			return HazardGuard<T>(this, rec, p);
+		}
+
+		//Never throws: when the retired list cannot grow, waits until no slot protects p and
+		//reclaims it on the spot; a scan that runs out of memory is left to the next Retire().
+		void Retire(void* p, void (*reclaim)(void*)) noexcept {
+			std::unique_lock<std::mutex> lock(_mutex);
+			try {
+				_retired.push_back({ p, reclaim });
+			}
+			catch (const std::bad_alloc&) {
+				lock.unlock();
+				_Wait_unprotected(p);
+				reclaim(p);
+				return;
+			}
+			if (_retired.size() >= _threshold) {
+				try {
+					_Scan(lock);
+				}
+				catch (const std::bad_alloc&) {
+				}
+			}
+		}
+
+		template<typename T, typename Deleter = _Default_delete_t<T>>
+		requires std::is_empty_v<Deleter> && std::is_default_constructible_v<Deleter>
+		void Retire(T* p) noexcept {
+			Retire(p, [](void* q) { Deleter()(static_cast<T*>(q)); });
+		}
+
+		void Scan() {
+			std::unique_lock<std::mutex> lock(_mutex);
+			_Scan(lock);
+		}
+
+		std::size_t RetiredCount() const {
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _retired.size();
+		}
+
+	private:
+		template<typename T>
+		friend class HazardGuard;
+
+		static std::uint64_t _Next_id() noexcept {
+			static std::atomic<std::uint64_t> next{ 1 };
+			return next.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		//Takes an idle record from the calling thread's cache, or claims one from the domain.
+		_Hazard_record* _Acquire() {
+			_Hazard_thread_cache::_Entry* cached = _Hazard_thread()._Find(_id);
+			if (cached && cached->_free) {
+				_Hazard_record* rec = cached->_free;
+				cached->_free = rec->_cached_next;
+				return rec;
+			}
+			for (_Hazard_record* rec = _head.load(std::memory_order_acquire); rec; rec = rec->_next) {
+				unsigned state = _Hazard_free;
+				if (rec->_state.load(std::memory_order_relaxed) == _Hazard_free && rec->_state.compare_exchange_strong(state, _Hazard_owned, std::memory_order_acquire, std::memory_order_relaxed)) {
+					return rec;
+				}
+			}
+			auto rec = new _Hazard_record;
+			rec->_state.store(_Hazard_owned, std::memory_order_relaxed);
+			_Hazard_record* head = _head.load(std::memory_order_relaxed);
+			do {
+				rec->_next = head;
+			} while (!_head.compare_exchange_weak(head, rec, std::memory_order_release, std::memory_order_relaxed));
+			return rec;
+		}
+
+		//Clears the slot and keeps the record in the releasing thread's cache.
+		void _Release(_Hazard_record* rec) noexcept {
+			rec->_hazard.store(nullptr, std::memory_order_release);
+			if (_Hazard_thread_cache::_Entry* cached = _Hazard_thread()._Find(_id)) {
+				rec->_cached_next = cached->_free;
+				cached->_free = rec;
+			}
+			else {
+				rec->_state.store(_Hazard_free, std::memory_order_release);
+			}
+		}
+
+		void _Wait_unprotected(void* p) const noexcept {
+			for (_Hazard_record* rec = _head.load(std::memory_order_acquire); rec; rec = rec->_next) {
+				while (rec->_hazard.load(std::memory_order_seq_cst) == p) {
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		void _Scan(std::unique_lock<std::mutex>& lock) {
+			std::vector<void*> hazards;
+			for (_Hazard_record* rec = _head.load(std::memory_order_acquire); rec; rec = rec->_next) {
+				if (void* h = rec->_hazard.load(std::memory_order_seq_cst)) {
+					hazards.push_back(h);
+				}
+			}
+			std::sort(hazards.begin(), hazards.end());
+
+			std::vector<_Retired_node> reclaimable;
+			auto keep = std::partition(_retired.begin(), _retired.end(), [&](const _Retired_node& r) {
+				return std::binary_search(hazards.begin(), hazards.end(), r._ptr);
+			});
+			reclaimable.assign(keep, _retired.end());
+			_retired.erase(keep, _retired.end());
+
+			lock.unlock();
+			for (auto& r : reclaimable) {
+				r._reclaim(r._ptr);
+			}
+			lock.lock();
+		}
+
+		std::uint64_t _id;
+		std::atomic<_Hazard_record*> _head{ nullptr };
+		mutable std::mutex _mutex;
+		std::vector<_Retired_node> _retired;
+		std::size_t _threshold;
+	};
+
+	template<typename T>
+	class HazardGuard {
+	public:
+		HazardGuard() noexcept : _domain(nullptr), _rec(nullptr), _ptr(nullptr) {}
+
+		HazardGuard(const HazardGuard&) = delete;
+		HazardGuard& operator=(const HazardGuard&) = delete;
+
+		HazardGuard(HazardGuard&& r) noexcept : _domain(std::exchange(r._domain, nullptr)), _rec(std::exchange(r._rec, nullptr)), _ptr(std::exchange(r._ptr, nullptr)) {}
+
+		HazardGuard& operator=(HazardGuard&& r) noexcept {
+			if (this != std::addressof(r)) {
+				Reset();
+				_domain = std::exchange(r._domain, nullptr);
+				_rec = std::exchange(r._rec, nullptr);
+				_ptr = std::exchange(r._ptr, nullptr);
+			}
+			return *this;
+		}
+
+		~HazardGuard() {
+			Reset();
+		}
+
+		void Reset() noexcept {
+			if (_rec) {
+				_domain->_Release(_rec);
+				_domain = nullptr;
+				_rec = nullptr;
+			}
+			_ptr = nullptr;
+		}
+
+		T* Get() const noexcept {
+			return _ptr;
+		}
+
+		explicit operator bool() const noexcept {
+			return Get() != nullptr;
+		}
+
+		T* operator->() const noexcept {
+			return Get();
+		}
+
+		T& operator*() const noexcept {
+			return *_ptr;
+		}
+
+	private:
+		friend class HazardPointerDomain;
+
+		HazardGuard(HazardPointerDomain* domain, _Hazard_record* rec, T* p) noexcept : _domain(domain), _rec(rec), _ptr(p) {}
+
+		HazardPointerDomain* _domain;
+		_Hazard_record* _rec;
+		T* _ptr;
+	};
+
+	//Deleter that hands the object to a hazard pointer domain instead of destroying it, so a
+	//UniquePtr<T, HazardRetire<T>> can be reset or reassigned while readers still hold guards.
+	//Like Retire(), it never throws, so it is safe in UniquePtr's noexcept Reset().
+	template<typename T, typename Deleter = _Default_delete_t<T>>
+	struct HazardRetire {
+		HazardPointerDomain* domain = &HazardPointerDomain::Default();
+
+		void operator()(T* p) const noexcept {
+			domain->template Retire<T, Deleter>(p);
+		}
+	};
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Rainbow3D {
+
+	template<typename Base>
+	struct _Inline_box_ops {
+		//Null for heap-allocated objects, which move by stealing the pointer.
+		Base* (*_move)(void* dst, Base* src) noexcept;
+		void (*_destroy)(Base* p) noexcept;
+	};
+
+	template<typename Base, typename Derived>
+	struct _Inline_box_inline_ops {
+		static constexpr _Inline_box_ops<Base> _Table = {
+			[](void* dst, Base* src) noexcept -> Base* {
+				Derived* s = static_cast<Derived*>(src);
+				Derived* d = ::new (dst) Derived(std::move(*s));
+				s->Derived::~Derived();
+				return d;
+			},
+			[](Base* p) noexcept {
+				static_cast<Derived*>(p)->Derived::~Derived();
+			}
+		};
+	};
+
+	template<typename Base, typename Derived, typename Deleter>
+	struct _Inline_box_heap_ops {
+		static constexpr _Inline_box_ops<Base> _Table = {
+			nullptr,
+			[](Base* p) noexcept {
+				Deleter()(static_cast<Derived*>(p));
+			}
+		};
+	};
+
+	//Owning polymorphic pointer with small-buffer storage. Objects derived from Base that fit in
+	//N bytes (and are nothrow-movable) are constructed inside the box, larger ones on the heap.
+	//Either way the box is used like UniquePtr<Base>; moving an inline object move-constructs it
+	//into the destination box, so Get() is not stable across moves.
+	template<typename Base, std::size_t N = 64, std::size_t Align = alignof(std::max_align_t)>
+	class InlineBox {
+	public:
+		using element_type = Base;
+		using pointer = Base*;
+
+		template<typename Derived>
+		static constexpr bool fits_inline = sizeof(Derived) <= N && alignof(Derived) <= Align && std::is_nothrow_move_constructible_v<Derived>;
+
+		InlineBox(const InlineBox&) = delete;
+		InlineBox& operator=(const InlineBox&) = delete;
+
+		constexpr InlineBox() noexcept : _ptr(nullptr), _ops(nullptr) {}
+
+		constexpr InlineBox(std::nullptr_t) noexcept : _ptr(nullptr), _ops(nullptr) {}
+
+		template <typename U, typename E>
+		requires std::is_convertible_v<typename UniquePtr<U, E>::pointer, pointer> && std::is_same_v<typename UniquePtr<U, E>::pointer, U*> && std::is_empty_v<E> && std::is_default_constructible_v<E> && (!std::is_array_v<U>)
+		InlineBox(UniquePtr<U, E>&& r) noexcept : _ptr(nullptr), _ops(nullptr) {
+			if (r) {
+				_ptr = r.Release();
+				_ops = &_Inline_box_heap_ops<Base, U, E>::_Table;
+			}
+		}
+
+		InlineBox(InlineBox&& r) noexcept : _ptr(nullptr), _ops(nullptr) {
+			_Steal(r);
+		}
+
+		~InlineBox() {
+			Reset();
+		}
+
+		InlineBox& operator=(InlineBox&& r) noexcept {
+			if (this != std::addressof(r)) {
+				Reset();
+				_Steal(r);
+			}
+			return *this;
+		}
+
+		InlineBox& operator=(std::nullptr_t) noexcept {
+			Reset();
+			return *this;
+		}
+
+		template<typename Derived, typename... Args>
+		requires std::is_convertible_v<Derived*, Base*>
+		Derived& Emplace(Args&&... args) {
+			Reset();
+			Derived* d;
+			if constexpr (fits_inline<Derived>) {
+				d = ::new (static_cast<void*>(_buf)) Derived(std::forward<Args>(args)...);
+				_ops = &_Inline_box_inline_ops<Base, Derived>::_Table;
+			}
+			else {
+				d = new Derived(std::forward<Args>(args)...);
+				_ops = &_Inline_box_heap_ops<Base, Derived, DefaultDelete<Derived>>::_Table;
+			}
+			_ptr = d;
+			return *d;
+		}
+
+		void Reset() noexcept {
+			if (_ptr) {
+				Base* p = std::exchange(_ptr, nullptr);
+				std::exchange(_ops, nullptr)->_destroy(p);
+			}
+		}
+
+		void Swap(InlineBox& other) noexcept {
+			InlineBox temp = std::move(other);
+			other = std::move(*this);
+			*this = std::move(temp);
+		}
+
+		pointer Get() const noexcept {
+			return _ptr;
+		}
+
+		bool IsInline() const noexcept {
+			return _ops && _ops->_move;
+		}
+
+		explicit operator bool() const noexcept {
+			return Get() != nullptr;
+		}
+
+		pointer operator->() const noexcept {
+			return Get();
+		}
+
+		Base& operator*() const noexcept {
+			return *_ptr;
+		}
+
+	private:
+		void _Steal(InlineBox& r) noexcept {
+			if (!r._ptr) {
+				return;
+			}
+			_ops = std::exchange(r._ops, nullptr);
+			Base* src = std::exchange(r._ptr, nullptr);
+			_ptr = _ops->_move ? _ops->_move(_buf, src) : src;
+		}
+
+		alignas(Align) unsigned char _buf[N];
+		pointer _ptr;
+		const _Inline_box_ops<Base>* _ops;
+	};
+
+	template<typename Base, typename Derived, std::size_t N = 64, std::size_t Align = alignof(std::max_align_t), typename... Args>
+	InlineBox<Base, N, Align> MakeInlineBox(Args&&... args) {
+		InlineBox<Base, N, Align> box;
+		box.template Emplace<Derived>(std::forward<Args>(args)...);
+		return box;
+	}
+}
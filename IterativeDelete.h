@@ -0,0 +1,80 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Rainbow3D {
+
+	struct _Iterative_delete_item {
+		void* _ptr;
+		void (*_delete)(void*) noexcept;
+	};
+
+	struct _Iterative_delete_state {
+		std::vector<_Iterative_delete_item> _work;
+		bool _draining = false;
+	};
+
+	inline _Iterative_delete_state& _Iterative_delete_local() noexcept {
+		thread_local _Iterative_delete_state state;
+		return state;
+	}
+
+	//Deleter that flattens recursive teardown. The outermost deletion on a thread runs normally;
+	//any IterativeDelete reached while it is running (the node's own UniquePtr children, however
+	//deep) only queues its pointer on a thread-local worklist, which the outermost call drains
+	//in a loop afterwards. Stack depth stays constant no matter how long the chain or how deep
+	//the tree. Children are destroyed after their parent rather than during its destructor, so
+	//node destructors must not use their children. Deleter does the actual deletion and has to
+	//be stateless.
+	template<typename T, typename Deleter = _Default_delete_t<T>>
+	struct IterativeDelete {
+		static_assert(std::is_empty_v<Deleter> && std::is_default_constructible_v<Deleter>, "IterativeDelete needs a stateless deleter");
+
+		constexpr IterativeDelete() noexcept = default;
+
+		template <typename U>
+		requires std::is_convertible_v<U*, T*>
+		IterativeDelete(const IterativeDelete<U>&) noexcept {}
+
+		void operator()(T* p) const noexcept {
+			_Iterative_delete_state& state = _Iterative_delete_local();
+			if (state._draining) {
+				try {
+					state._work.push_back({ const_cast<void*>(static_cast<const void*>(p)), &_Delete });
+					return;
+				}
+				catch (const std::bad_alloc&) {
+					//Out of memory for the worklist: fall back to plain recursion for this node.
+				}
+				Deleter()(p);
+				return;
+			}
+			state._draining = true;
+			Deleter()(p);
+			while (!state._work.empty()) {
+				_Iterative_delete_item item = state._work.back();
+				state._work.pop_back();
+				item._delete(item._ptr);
+			}
+			state._draining = false;
+		}
+
+	private:
+		static void _Delete(void* p) noexcept {
+			Deleter()(static_cast<T*>(p));
+		}
+	};
+
+	template<typename T>
+	using IterativeUniquePtr = UniquePtr<T, IterativeDelete<T>>;
+
+	template<typename T, typename... Args>
+	requires (!std::is_array_v<T>)
+	IterativeUniquePtr<T> MakeIterativeUnique(Args&&... args) {
+		return IterativeUniquePtr<T>(new T(std::forward<Args>(args)...));
+	}
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstddef>
+#include <system_error>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Rainbow3D {
+
+	//Read-write shared mapping of a file (or, through Adopt, of any region the caller mapped
+	//itself), unmapped on destruction. Failures throw std::system_error.
+	class MappedRegion {
+	public:
+		MappedRegion() noexcept : _data(nullptr), _size(0) {}
+
+		MappedRegion(const MappedRegion&) = delete;
+		MappedRegion& operator=(const MappedRegion&) = delete;
+
+		MappedRegion(MappedRegion&& r) noexcept : _data(std::exchange(r._data, nullptr)), _size(std::exchange(r._size, 0)) {}
+
+		MappedRegion& operator=(MappedRegion&& r) noexcept {
+			if (this != &r) {
+				Reset();
+				_data = std::exchange(r._data, nullptr);
+				_size = std::exchange(r._size, 0);
+			}
+			return *this;
+		}
+
+		~MappedRegion() {
+			Reset();
+		}
+
+		//Maps path into memory. With create the file is created if needed and sized to size;
+		//otherwise size 0 maps the whole existing file.
+		static MappedRegion MapFile(const char* path, std::size_t size, bool create) {
+#if defined(_WIN32)
+			HANDLE file = ::CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, create ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE) {
+				_Throw_last_error("CreateFileA");
+			}
+			if (!create && size == 0) {
+				LARGE_INTEGER length;
+				if (!::GetFileSizeEx(file, &length)) {
+					::CloseHandle(file);
+					_Throw_last_error("GetFileSizeEx");
+				}
+				size = static_cast<std::size_t>(length.QuadPart);
+			}
+			unsigned long long length = size;
+			HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(length >> 32), static_cast<DWORD>(length), nullptr);
+			::CloseHandle(file);
+			if (!mapping) {
+				_Throw_last_error("CreateFileMappingA");
+			}
+			void* data = ::MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+			::CloseHandle(mapping);
+			if (!data) {
+				_Throw_last_error("MapViewOfFile");
+			}
+			return Adopt(data, size);
+#else
+			int fd = ::open(path, O_RDWR | (create ? O_CREAT : 0), 0644);
+			if (fd < 0) {
+				_Throw_last_error("open");
+			}
+			try {
+				return MapDescriptor(fd, size, create);
+			}
+			catch (...) {
+				::close(fd);
+				throw;
+			}
+#endif
+		}
+
+#if !defined(_WIN32)
+		//Maps an open descriptor (a file or a shm_open object) and closes it; the mapping keeps the
+		//object alive. With resize the object is first truncated to size.
+		static MappedRegion MapDescriptor(int fd, std::size_t size, bool resize) {
+			if (resize) {
+				if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+					_Throw_last_error("ftruncate");
+				}
+			}
+			else if (size == 0) {
+				struct stat st;
+				if (::fstat(fd, &st) != 0) {
+					_Throw_last_error("fstat");
+				}
+				size = static_cast<std::size_t>(st.st_size);
+			}
+			void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (data == MAP_FAILED) {
+				_Throw_last_error("mmap");
+			}
+			::close(fd);
+			return Adopt(data, size);
+		}
+#endif
+
+		//Takes ownership of a mapping created elsewhere.
+		static MappedRegion Adopt(void* data, std::size_t size) noexcept {
+			MappedRegion r;
+			r._data = data;
+			r._size = size;
+			return r;
+		}
+
+		void Flush() {
+			if (!_data) {
+				return;
+			}
+#if defined(_WIN32)
+			if (!::FlushViewOfFile(_data, _size)) {
+				_Throw_last_error("FlushViewOfFile");
+			}
+#else
+			if (::msync(_data, _size, MS_SYNC) != 0) {
+				_Throw_last_error("msync");
+			}
+#endif
+		}
+
+		void Reset() noexcept {
+			if (_data) {
+#if defined(_WIN32)
+				::UnmapViewOfFile(_data);
+#else
+				::munmap(_data, _size);
+#endif
+				_data = nullptr;
+				_size = 0;
+			}
+		}
+
+		void* Data() const noexcept {
+			return _data;
+		}
+
+		std::size_t Size() const noexcept {
+			return _size;
+		}
+
+		explicit operator bool() const noexcept {
+			return _data != nullptr;
+		}
+
+	private:
+		[[noreturn]] static void _Throw_last_error(const char* what) {
+#if defined(_WIN32)
+			throw std::system_error(static_cast<int>(::GetLastError()), std::system_category(), what);
+#else
+			throw std::system_error(errno, std::system_category(), what);
+#endif
+		}
+
+		void* _data;
+		std::size_t _size;
+	};
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define RAINBOW3D_ASSUME(cond) __assume(cond)
+#else
+#define RAINBOW3D_ASSUME(cond) ((cond) ? static_cast<void>(0) : __builtin_unreachable())
+#endif
+
+namespace Rainbow3D {
+
+	//UniquePtr that always owns an object. The pointer is checked once when it enters the type
+	//(construction and Reset throw std::invalid_argument on null) and is assumed non-null from
+	//then on, so Get(), operator-> and operator* carry no null test and let the optimizer drop
+	//the caller's. Moving out through the move constructor or ToUnique() leaves the source in a
+	//moved-from state that may only be destroyed or assigned to; the destructor keeps a single,
+	//predicted test for that state.
+	template<typename T, typename Deleter = _Default_delete_t<T>>
+	class NonNullUniquePtr {
+	public:
+		using deleter_type = Deleter;
+		using element_type = T;
+		using pointer = typename _Get_deleter_pointer_type<element_type, std::remove_reference_t<deleter_type>>::type;
+
+		NonNullUniquePtr() = delete;
+		NonNullUniquePtr(std::nullptr_t) = delete;
+		NonNullUniquePtr(const NonNullUniquePtr&) = delete;
+		NonNullUniquePtr& operator=(const NonNullUniquePtr&) = delete;
+
+		template <typename = void>
+		requires (!std::is_pointer_v<deleter_type>) && std::is_default_constructible_v<deleter_type>
+		explicit NonNullUniquePtr(pointer p) : _ptr(_Check(p)), _d() {}
+
+		template <typename = void>
+		requires (!std::is_lvalue_reference_v<deleter_type>) && std::is_constructible_v<deleter_type, deleter_type&&>
+		NonNullUniquePtr(pointer p, deleter_type&& d) : _ptr(_Check(p)), _d(std::move(d)) {}
+
+		template <typename = void>
+		requires (!std::is_lvalue_reference_v<deleter_type>) && std::is_constructible_v<deleter_type, const deleter_type&>
+		NonNullUniquePtr(pointer p, const deleter_type& d) : _ptr(_Check(p)), _d(d) {}
+
+		template <typename = void>
+		requires std::is_move_constructible_v<deleter_type>
+		explicit NonNullUniquePtr(UniquePtr<T, Deleter>&& r) : _ptr(_Check(r.Get())), _d(std::forward<deleter_type>(r.GetDeleter())) {
+			r.Release();
+		}
+
+		template <typename = void>
+		requires std::is_move_constructible_v<deleter_type>
+		NonNullUniquePtr(NonNullUniquePtr&& r) noexcept : _ptr(std::exchange(r._ptr, nullptr)), _d(std::forward<deleter_type>(r._d)) {}
+
+		~NonNullUniquePtr() {
+			if (_ptr) [[likely]] {
+				_d(_ptr);
+			}
+		}
+
+		template <typename = void>
+		requires std::is_move_assignable_v<deleter_type>
+		NonNullUniquePtr& operator=(NonNullUniquePtr&& r) noexcept {
+			if (this != std::addressof(r)) {
+				pointer old = std::exchange(_ptr, std::exchange(r._ptr, nullptr));
+				if (old) {
+					_d(old);
+				}
+				_d = std::forward<deleter_type>(r._d);
+			}
+			return *this;
+		}
+
+		void Reset(pointer p) {
+			_Check(p);
+			pointer old = std::exchange(_ptr, p);
+			if (old) {
+				_d(old);
+			}
+		}
+
+		//Hands ownership back to a (nullable) UniquePtr, leaving *this moved-from.
+		UniquePtr<T, Deleter> ToUnique() && noexcept {
+			return UniquePtr<T, Deleter>(std::exchange(_ptr, nullptr), std::forward<deleter_type>(_d));
+		}
+
+		void Swap(NonNullUniquePtr& other) noexcept {
+			std::swap(_ptr, other._ptr);
+			std::swap(_d, other._d);
+		}
+
+		pointer Get() const noexcept {
+			RAINBOW3D_ASSUME(_ptr != nullptr);
+			return _ptr;
+		}
+
+		deleter_type& GetDeleter() noexcept {
+			return _d;
+		}
+
+		const deleter_type& GetDeleter() const noexcept {
+			return _d;
+		}
+
+		pointer operator->() const noexcept {
+			return Get();
+		}
+
+		std::add_lvalue_reference_t<T> operator*() const noexcept(noexcept(*std::declval<pointer>())) {
+			return *Get();
+		}
+
+	private:
+		static pointer _Check(pointer p) {
+			if (!p) {
+				throw std::invalid_argument("NonNullUniquePtr requires a non-null pointer");
+			}
+			return p;
+		}
+
+		pointer _ptr;
+		RAINBOW3D_NO_UNIQUE_ADDRESS deleter_type _d;
+	};
+
+	template<typename T, typename... Args>
+	requires (!std::is_array_v<T>)
+	NonNullUniquePtr<T> MakeNonNullUnique(Args&&... args) {
+		return NonNullUniquePtr<T>(new T(std::forward<Args>(args)...));
+	}
+}
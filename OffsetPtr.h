@@ -0,0 +1,213 @@
+#pragma once
+
+#include "SegmentAllocator.h"
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Rainbow3D {
+
+	//Pointer stored as the distance from itself to its target, so a structure built from
+	//OffsetPtrs stays valid wherever the memory holding it is mapped. An offset of 1 encodes null
+	//(0 would be the pointer pointing at itself). Copying re-encodes relative to the destination,
+	//so OffsetPtr is not trivially copyable: move graphs by remapping, not by memcpy. The target
+	//is generally a different object than the pointer, so the distance is computed on integers;
+	//pointer arithmetic from this would be undefined and lets the optimizer assume the target
+	//lies inside whatever object holds the OffsetPtr.
+	template<typename T>
+	class OffsetPtr {
+	public:
+		using element_type = T;
+		using pointer = T*;
+
+		OffsetPtr() noexcept : _off(_Null) {}
+
+		OffsetPtr(std::nullptr_t) noexcept : _off(_Null) {}
+
+		OffsetPtr(pointer p) noexcept : _off(_Encode(p)) {}
+
+		OffsetPtr(const OffsetPtr& r) noexcept : _off(_Encode(r.Get())) {}
+
+		template <typename U>
+		requires std::is_convertible_v<U*, T*>
+		OffsetPtr(const OffsetPtr<U>& r) noexcept : _off(_Encode(r.Get())) {}
+
+		OffsetPtr& operator=(const OffsetPtr& r) noexcept {
+			_off = _Encode(r.Get());
+			return *this;
+		}
+
+		OffsetPtr& operator=(pointer p) noexcept {
+			_off = _Encode(p);
+			return *this;
+		}
+
+		OffsetPtr& operator=(std::nullptr_t) noexcept {
+			_off = _Null;
+			return *this;
+		}
+
+		pointer Get() const noexcept {
+			if (_off == _Null) {
+				return nullptr;
+			}
+			return reinterpret_cast<pointer>(reinterpret_cast<std::uintptr_t>(this) + static_cast<std::uintptr_t>(_off));
+		}
+
+		explicit operator bool() const noexcept {
+			return _off != _Null;
+		}
+
+		pointer operator->() const noexcept {
+			return Get();
+		}
+
+		std::add_lvalue_reference_t<T> operator*() const noexcept {
+			return *Get();
+		}
+
+		friend bool operator==(const OffsetPtr& l, const OffsetPtr& r) noexcept {
+			return l.Get() == r.Get();
+		}
+
+		friend bool operator==(const OffsetPtr& l, std::nullptr_t) noexcept {
+			return !l;
+		}
+
+		friend auto operator<=>(const OffsetPtr& l, const OffsetPtr& r) noexcept {
+			return std::compare_three_way{}(l.Get(), r.Get());
+		}
+
+	private:
+		static constexpr std::ptrdiff_t _Null = 1;
+
+		std::ptrdiff_t _Encode(pointer p) const noexcept {
+			if (!p) {
+				return _Null;
+			}
+			return static_cast<std::ptrdiff_t>(reinterpret_cast<std::uintptr_t>(p) - reinterpret_cast<std::uintptr_t>(this));
+		}
+
+		std::ptrdiff_t _off;
+	};
+
+	//Destroys a T that lives in a SegmentAllocator block and frees the block. Stateless: the
+	//block header leads back to its segment.
+	template<typename T>
+	struct SegmentDelete {
+		void operator()(T* p) const noexcept {
+			p->~T();
+			SegmentAllocator::Deallocate(p);
+		}
+
+		//Batch hook for DestroyAll: destroys every object, then frees the blocks with one lock per
+		//segment.
+		void DeleteBatch(T* const* ptrs, std::size_t n) const noexcept {
+			for (std::size_t i = 0; i < n; ++i) {
+				ptrs[i]->~T();
+			}
+			SegmentAllocator::DeallocateBatch(ptrs, n);
+		}
+	};
+
+	//Owning OffsetPtr for objects allocated from a SegmentAllocator. Since both the link and the
+	//allocator are position-independent, an ownership graph built from OffsetUniquePtr members can
+	//be persisted in a mapped file or shared between processes and used without fix-up. The owned
+	//types must themselves be position-independent: no raw pointers and no virtual functions.
+	template<typename T>
+	class OffsetUniquePtr {
+	public:
+		using element_type = T;
+		using pointer = T*;
+		using deleter_type = SegmentDelete<T>;
+
+		OffsetUniquePtr() noexcept = default;
+
+		OffsetUniquePtr(std::nullptr_t) noexcept {}
+
+		//p must point into a SegmentAllocator block.
+		explicit OffsetUniquePtr(pointer p) noexcept : _ptr(p) {}
+
+		OffsetUniquePtr(const OffsetUniquePtr&) = delete;
+		OffsetUniquePtr& operator=(const OffsetUniquePtr&) = delete;
+
+		OffsetUniquePtr(OffsetUniquePtr&& r) noexcept : _ptr(r.Release()) {}
+
+		~OffsetUniquePtr() {
+			if (pointer p = _ptr.Get()) {
+				deleter_type()(p);
+			}
+		}
+
+		OffsetUniquePtr& operator=(OffsetUniquePtr&& r) noexcept {
+			if (this != std::addressof(r)) {
+				Reset(r.Release());
+			}
+			return *this;
+		}
+
+		OffsetUniquePtr& operator=(std::nullptr_t) noexcept {
+			Reset();
+			return *this;
+		}
+
+		pointer Release() noexcept {
+			pointer p = _ptr.Get();
+			_ptr = nullptr;
+			return p;
+		}
+
+		void Reset(pointer p = nullptr) noexcept {
+			pointer old = _ptr.Get();
+			_ptr = p;
+			if (old) {
+				deleter_type()(old);
+			}
+		}
+
+		void Swap(OffsetUniquePtr& other) noexcept {
+			pointer p = other._ptr.Get();
+			other._ptr = _ptr.Get();
+			_ptr = p;
+		}
+
+		pointer Get() const noexcept {
+			return _ptr.Get();
+		}
+
+		explicit operator bool() const noexcept {
+			return static_cast<bool>(_ptr);
+		}
+
+		pointer operator->() const noexcept {
+			return Get();
+		}
+
+		T& operator*() const noexcept {
+			return *Get();
+		}
+
+	private:
+		OffsetPtr<T> _ptr;
+	};
+
+	template<typename T, typename... Args>
+	OffsetUniquePtr<T> MakeOffsetUnique(SegmentAllocator& segment, Args&&... args) {
+		static_assert(!std::is_polymorphic_v<T>, "objects in a segment cannot hold vtable pointers");
+		static_assert(alignof(T) <= SegmentAllocator::max_align, "SegmentAllocator alignment is limited to 16 bytes");
+		void* mem = segment.Allocate(sizeof(T), alignof(T));
+		T* p;
+		try {
+			p = ::new (mem) T(std::forward<Args>(args)...);
+		}
+		catch (...) {
+			SegmentAllocator::Deallocate(mem);
+			throw;
+		}
+		return OffsetUniquePtr<T>(p);
+	}
+}
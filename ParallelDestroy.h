@@ -0,0 +1,190 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include "IterativeDelete.h"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Rainbow3D {
+
+	//Whether a deleter may run on several threads at once for different objects. Library deleters
+	//that only call the destructor and the global allocator qualify; a custom deleter opts in
+	//with `static constexpr bool is_concurrent = true;` or by specializing this trait. Everything
+	//else is destroyed on the calling thread.
+	template<typename D>
+	struct IsConcurrentDeleter : std::bool_constant<requires { requires D::is_concurrent; }> {};
+
+	template<typename T>
+	struct IsConcurrentDeleter<std::default_delete<T>> : std::true_type {};
+
+	template<typename T>
+	struct IsConcurrentDeleter<DefaultDelete<T>> : std::true_type {};
+
+	template<typename Base>
+	struct IsConcurrentDeleter<ConcreteDelete<Base>> : std::true_type {};
+
+	template<typename T, typename D>
+	struct IsConcurrentDeleter<IterativeDelete<T, D>> : IsConcurrentDeleter<D> {};
+
+	//Below this many objects per thread, spawning costs more than it saves.
+	inline constexpr std::size_t _Parallel_destroy_grain = 4096;
+
+	inline unsigned _Parallel_destroy_threads(unsigned threads) noexcept {
+		if (threads == 0) {
+			threads = std::thread::hardware_concurrency();
+		}
+		return threads == 0 ? 1 : threads;
+	}
+
+	//Runs fn(begin, end) over [0, count) split into up to threads chunks, one per worker, with the
+	//calling thread taking the last chunk. If a worker cannot be started its chunk runs here.
+	template<typename Fn>
+	void _Parallel_destroy_chunks(std::size_t count, unsigned threads, Fn&& fn) {
+		std::size_t chunks = std::min<std::size_t>(threads, (count + _Parallel_destroy_grain - 1) / _Parallel_destroy_grain);
+		if (chunks <= 1) {
+			fn(std::size_t(0), count);
+			return;
+		}
+		std::vector<std::thread> workers;
+		workers.reserve(chunks - 1);
+		std::size_t step = count / chunks;
+		for (std::size_t i = 0; i + 1 < chunks; ++i) {
+			std::size_t begin = i * step;
+			try {
+				workers.emplace_back([&fn, begin, step] { fn(begin, begin + step); });
+			}
+			catch (const std::system_error&) {
+				fn(begin, begin + step);
+			}
+		}
+		fn((chunks - 1) * step, count);
+		for (std::thread& t : workers) {
+			t.join();
+		}
+	}
+
+	//Destroys every object owned by a random-access range of UniquePtrs, splitting the range
+	//across up to threads threads (0 = one per hardware thread). The elements are left null; the
+	//container itself is not resized. Falls back to the calling thread when the deleter is not
+	//declared concurrent.
+	template<std::ranges::random_access_range R>
+	void ParallelDestroy(R&& range, unsigned threads = 0) {
+		using _Ptr = std::ranges::range_value_t<R>;
+		using _Deleter = typename _Ptr::deleter_type;
+		auto first = std::ranges::begin(range);
+		std::size_t count = static_cast<std::size_t>(std::ranges::distance(range));
+		auto reset = [first](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				first[static_cast<std::ptrdiff_t>(i)].Reset();
+			}
+		};
+		if constexpr (IsConcurrentDeleter<_Deleter>::value) {
+			_Parallel_destroy_chunks(count, _Parallel_destroy_threads(threads), reset);
+		}
+		else {
+			reset(0, count);
+		}
+	}
+
+	//Counts the nodes reachable from root through links of its own UniquePtr type, stopping at limit.
+	template<typename T, typename D>
+	std::size_t _Parallel_destroy_tree_size(T* root, std::size_t limit) {
+		std::vector<T*> stack{ root };
+		std::size_t count = 0;
+		while (!stack.empty() && count < limit) {
+			T* node = stack.back();
+			stack.pop_back();
+			++count;
+			node->Visit([&stack]<typename U, typename E>(UniquePtr<U, E>& child) {
+				if constexpr (std::is_same_v<U, T> && std::is_same_v<E, D>) {
+					if (child) {
+						stack.push_back(child.Get());
+					}
+				}
+			});
+		}
+		return count;
+	}
+
+	//Destroys a tree owned by root in parallel. Node types expose their links with the same
+	//Visit(v) member GraphImage uses; links of root's own UniquePtr type are split off breadth
+	//first until there are enough independent subtrees for every thread, the subtrees are
+	//destroyed concurrently, and the few detached upper nodes go last on the calling thread
+	//(along with any links of other types, which stay attached). Children are therefore
+	//destroyed before the destructor of their parent runs. Deep subtrees are still torn down
+	//recursively unless the deleter is IterativeDelete. As with ParallelDestroy, every thread gets
+	//at least _Parallel_destroy_grain nodes; the tree is counted up to that many per thread first,
+	//and smaller trees are destroyed on the calling thread without splitting.
+	template<typename T, typename D>
+	void ParallelDestroyTree(UniquePtr<T, D>& root, unsigned threads = 0) {
+		threads = _Parallel_destroy_threads(threads);
+		if constexpr (!IsConcurrentDeleter<D>::value) {
+			root.Reset();
+		}
+		else {
+			if (threads <= 1 || !root) {
+				root.Reset();
+				return;
+			}
+			std::size_t size = _Parallel_destroy_tree_size<T, D>(root.Get(), static_cast<std::size_t>(threads) * _Parallel_destroy_grain);
+			threads = static_cast<unsigned>(std::min<std::size_t>(threads, size / _Parallel_destroy_grain));
+			if (threads <= 1) {
+				root.Reset();
+				return;
+			}
+			std::vector<UniquePtr<T, D>> nodes;
+			nodes.push_back(std::move(root));
+			std::size_t expanded = 0;
+			//A list or spine keeps the frontier at one node, so the split also stops after a
+			//bounded number of detached nodes; whatever is left goes to the calling thread.
+			std::size_t want = static_cast<std::size_t>(threads) * 8;
+			std::size_t limit = want * 64;
+			while (expanded < nodes.size() && nodes.size() - expanded < want && expanded < limit) {
+				T* node = nodes[expanded++].Get();
+				node->Visit([&nodes]<typename U, typename E>(UniquePtr<U, E>& child) {
+					if constexpr (std::is_same_v<U, T> && std::is_same_v<E, D>) {
+						if (child) {
+							nodes.push_back(std::move(child));
+						}
+					}
+				});
+			}
+			std::size_t subtrees = nodes.size() - expanded;
+			auto reset = [&nodes, expanded](std::size_t begin, std::size_t end) {
+				for (std::size_t i = begin; i < end; ++i) {
+					nodes[expanded + i].Reset();
+				}
+			};
+			std::size_t chunks = std::min<std::size_t>(threads, subtrees);
+			std::vector<std::thread> workers;
+			if (chunks > 1) {
+				workers.reserve(chunks - 1);
+			}
+			for (std::size_t i = 1; i < chunks; ++i) {
+				std::size_t begin = subtrees * i / chunks;
+				std::size_t end = subtrees * (i + 1) / chunks;
+				try {
+					workers.emplace_back([&reset, begin, end] { reset(begin, end); });
+				}
+				catch (const std::system_error&) {
+					reset(begin, end);
+				}
+			}
+			reset(0, chunks == 0 ? 0 : subtrees / chunks);
+			for (std::thread& t : workers) {
+				t.join();
+			}
+			while (expanded > 0) {
+				nodes[--expanded].Reset();
+			}
+		}
+	}
+}
@@ -0,0 +1,397 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Rainbow3D {
+
+	template<typename Base>
+	struct _Poly_ops {
+		std::size_t _size;
+		std::size_t _align;
+		Base* (*_relocate)(void* dst, void* src) noexcept;
+		void (*_destroy)(void* p) noexcept;
+		Base* (*_extract)(void* src);
+		ConcreteDelete<Base> _deleter;
+	};
+
+	template<typename Base, typename Derived>
+	struct _Poly_ops_for {
+		static constexpr _Poly_ops<Base> _Table = {
+			sizeof(Derived),
+			alignof(Derived),
+			[](void* dst, void* src) noexcept -> Base* {
+				Derived* s = static_cast<Derived*>(src);
+				Derived* d = ::new (dst) Derived(std::move(*s));
+				s->Derived::~Derived();
+				return d;
+			},
+			[](void* p) noexcept {
+				static_cast<Derived*>(p)->Derived::~Derived();
+			},
+			[](void* src) -> Base* {
+				Derived* s = static_cast<Derived*>(src);
+				Derived* d = new Derived(std::move(*s));
+				s->Derived::~Derived();
+				return d;
+			},
+			ConcreteDelete<Base>::template For<Derived>()
+		};
+	};
+
+	template<typename Base>
+	struct _Poly_entry {
+		Base* _base;
+		std::size_t _offset;
+		const _Poly_ops<Base>* _ops;
+	};
+
+	//Vector of heterogeneous objects derived from Base, packed back to back in one buffer so a
+	//pass of virtual calls walks memory linearly instead of chasing a pointer per element.
+	//Erase() destroys an element in place and leaves its bytes as a hole: it never allocates
+	//and never moves other elements, so pointers and references to the remaining elements stay
+	//valid, while iterators at or after the erased position are invalidated. Holes are
+	//reclaimed when the buffer fills up or by Compact(), both of which relocate every element
+	//(nothrow move + destroy) and so invalidate all references; a full buffer is reallocated at
+	//twice the live bytes, so capacity follows the live elements rather than the number of
+	//emplaces. Extract() moves an element out into a heap-owned UniquePtr when it has to
+	//outlive its slot.
+	template<typename Base, std::size_t Align = alignof(std::max_align_t)>
+	class PolyVector {
+	public:
+		using value_type = Base;
+		using size_type = std::size_t;
+
+		class iterator {
+		public:
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type = Base;
+			using difference_type = std::ptrdiff_t;
+			using pointer = Base*;
+			using reference = Base&;
+
+			iterator() noexcept = default;
+
+			reference operator*() const noexcept {
+				return *_it->_base;
+			}
+
+			pointer operator->() const noexcept {
+				return _it->_base;
+			}
+
+			reference operator[](difference_type n) const noexcept {
+				return *_it[n]._base;
+			}
+
+			iterator& operator++() noexcept {
+				++_it;
+				return *this;
+			}
+
+			iterator operator++(int) noexcept {
+				iterator t = *this;
+				++_it;
+				return t;
+			}
+
+			iterator& operator--() noexcept {
+				--_it;
+				return *this;
+			}
+
+			iterator operator--(int) noexcept {
+				iterator t = *this;
+				--_it;
+				return t;
+			}
+
+			iterator& operator+=(difference_type n) noexcept {
+				_it += n;
+				return *this;
+			}
+
+			iterator& operator-=(difference_type n) noexcept {
+				_it -= n;
+				return *this;
+			}
+
+			friend iterator operator+(iterator i, difference_type n) noexcept {
+				return i += n;
+			}
+
+			friend iterator operator+(difference_type n, iterator i) noexcept {
+				return i += n;
+			}
+
+			friend iterator operator-(iterator i, difference_type n) noexcept {
+				return i -= n;
+			}
+
+			friend difference_type operator-(const iterator& l, const iterator& r) noexcept {
+				return l._it - r._it;
+			}
+
+			friend bool operator==(const iterator& l, const iterator& r) noexcept {
+				return l._it == r._it;
+			}
+
+			friend auto operator<=>(const iterator& l, const iterator& r) noexcept {
+				return l._it <=> r._it;
+			}
+
+		private:
+			friend class PolyVector;
+
+			using _Base_it = typename std::vector<_Poly_entry<Base>>::const_iterator;
+
+			explicit iterator(_Base_it it) noexcept : _it(it) {}
+
+			_Base_it _it;
+		};
+
+		PolyVector() noexcept : _buf(nullptr), _used(0), _capacity(0) {}
+
+		explicit PolyVector(size_type bytes) : PolyVector() {
+			Reserve(bytes);
+		}
+
+		PolyVector(const PolyVector&) = delete;
+		PolyVector& operator=(const PolyVector&) = delete;
+
+		PolyVector(PolyVector&& r) noexcept : _buf(std::exchange(r._buf, nullptr)), _used(std::exchange(r._used, 0)), _capacity(std::exchange(r._capacity, 0)), _entries(std::move(r._entries)) {
+			r._entries.clear();
+		}
+
+		PolyVector& operator=(PolyVector&& r) noexcept {
+			if (this != std::addressof(r)) {
+				Clear();
+				_Free(_buf);
+				_buf = std::exchange(r._buf, nullptr);
+				_used = std::exchange(r._used, 0);
+				_capacity = std::exchange(r._capacity, 0);
+				_entries = std::move(r._entries);
+				r._entries.clear();
+			}
+			return *this;
+		}
+
+		~PolyVector() {
+			Clear();
+			_Free(_buf);
+		}
+
+		template<typename Derived, typename... Args>
+		requires std::is_convertible_v<Derived*, Base*>
+		Derived& Emplace(Args&&... args) {
+			static_assert(alignof(Derived) <= Align, "PolyVector alignment is too small for this type");
+			static_assert(std::is_nothrow_move_constructible_v<Derived>, "PolyVector elements must be nothrow move constructible");
+			std::size_t offset = _Align_up(_used, alignof(Derived));
+			if (offset + sizeof(Derived) > _capacity) {
+				//Size the new buffer from the live bytes, not the old capacity, so holes left by
+				//Erase() are reclaimed instead of growing the buffer.
+				std::size_t need = _Align_up(_Packed_size(), alignof(Derived)) + sizeof(Derived);
+				std::size_t want = _capacity;
+				if (need > _capacity / 2) {
+					want = need * 2;
+				}
+				_Rebuild(want, _entries.size());
+				offset = _Align_up(_used, alignof(Derived));
+			}
+			if (_entries.size() == _entries.capacity()) {
+				_entries.reserve(_entries.empty() ? 8 : _entries.size() * 2);
+			}
+			Derived* d = ::new (static_cast<void*>(_buf + offset)) Derived(std::forward<Args>(args)...);
+			_entries.push_back({ d, offset, &_Poly_ops_for<Base, Derived>::_Table });
+			_used = offset + sizeof(Derived);
+			return *d;
+		}
+
+		//Shifts only the entry table, as std::vector::erase would; use EraseIf() to remove many
+		//elements in one pass.
+		void Erase(size_type index) noexcept {
+			_Poly_entry<Base>& e = _entries[index];
+			e._ops->_destroy(_buf + e._offset);
+			_Remove_entry(index);
+		}
+
+		iterator Erase(iterator pos) noexcept {
+			size_type index = static_cast<size_type>(pos._it - _entries.cbegin());
+			Erase(index);
+			return begin() + static_cast<std::ptrdiff_t>(index);
+		}
+
+		//Moves the element at index into its own heap allocation and removes its slot.
+		UniquePtr<Base, ConcreteDelete<Base>> Extract(size_type index) {
+			_Poly_entry<Base>& e = _entries[index];
+			const _Poly_ops<Base>* ops = e._ops;
+			UniquePtr<Base, ConcreteDelete<Base>> r(ops->_extract(_buf + e._offset), ops->_deleter);
+			_Remove_entry(index);
+			return r;
+		}
+
+		//Destroys every element for which pred returns true in a single pass and returns how
+		//many were removed; the linear replacement for an erase-while-iterating loop.
+		template<typename Pred>
+		size_type EraseIf(Pred pred) {
+			size_type out = 0;
+			size_type i = 0;
+			try {
+				for (; i < _entries.size(); ++i) {
+					_Poly_entry<Base> e = _entries[i];
+					if (pred(*e._base)) {
+						e._ops->_destroy(_buf + e._offset);
+					}
+					else {
+						_entries[out++] = e;
+					}
+				}
+			}
+			catch (...) {
+				for (; i < _entries.size(); ++i) {
+					_entries[out++] = _entries[i];
+				}
+				_Truncate_entries(out);
+				throw;
+			}
+			size_type removed = _entries.size() - out;
+			_Truncate_entries(out);
+			return removed;
+		}
+
+		//Packs the live elements back to back, reclaiming the holes left by Erase(). Relocates
+		//every element into a fresh buffer, so it invalidates all references.
+		void Compact() {
+			if (_entries.empty()) {
+				_used = 0;
+			}
+			else if (_Has_holes()) {
+				_Rebuild(_capacity, _entries.size());
+			}
+		}
+
+		void Clear() noexcept {
+			for (auto& e : _entries) {
+				e._ops->_destroy(_buf + e._offset);
+			}
+			_entries.clear();
+			_used = 0;
+		}
+
+		void Reserve(size_type bytes) {
+			if (bytes > _capacity) {
+				_Rebuild(bytes, _entries.size());
+			}
+		}
+
+		Base& operator[](size_type index) const noexcept {
+			return *_entries[index]._base;
+		}
+
+		size_type Size() const noexcept {
+			return _entries.size();
+		}
+
+		bool Empty() const noexcept {
+			return _entries.empty();
+		}
+
+		size_type Bytes() const noexcept {
+			return _used;
+		}
+
+		iterator begin() const noexcept {
+			return iterator(_entries.cbegin());
+		}
+
+		iterator end() const noexcept {
+			return iterator(_entries.cend());
+		}
+
+	private:
+		static std::size_t _Align_up(std::size_t n, std::size_t a) noexcept {
+			return (n + a - 1) & ~(a - 1);
+		}
+
+		static unsigned char* _Allocate(std::size_t bytes) {
+			return static_cast<unsigned char*>(::operator new(bytes, std::align_val_t(Align)));
+		}
+
+		static void _Free(unsigned char* p) noexcept {
+			if (p) {
+				::operator delete(p, std::align_val_t(Align));
+			}
+		}
+
+		//Relocates every live element except skip into a new buffer of the given capacity.
+		void _Rebuild(std::size_t capacity, size_type skip) {
+			unsigned char* buf = _Allocate(capacity);
+			_Relocate_into(buf, skip);
+			_Free(std::exchange(_buf, buf));
+			_capacity = capacity;
+		}
+
+		//Drops the entry of an already destroyed element; its bytes stay behind as a hole.
+		void _Remove_entry(size_type index) noexcept {
+			_entries.erase(_entries.begin() + static_cast<std::ptrdiff_t>(index));
+			if (index == _entries.size()) {
+				_Truncate_entries(index);
+			}
+		}
+
+		//Shrinks the entry list to count and pulls the end of the used bytes back to the last
+		//survivor, so trailing holes are reused by the next Emplace().
+		void _Truncate_entries(size_type count) noexcept {
+			_entries.resize(count);
+			_used = _entries.empty() ? 0 : _entries.back()._offset + _entries.back()._ops->_size;
+		}
+
+		//Bytes the live elements would take packed back to back.
+		std::size_t _Packed_size() const noexcept {
+			std::size_t used = 0;
+			for (const auto& e : _entries) {
+				used = _Align_up(used, e._ops->_align) + e._ops->_size;
+			}
+			return used;
+		}
+
+		bool _Has_holes() const noexcept {
+			std::size_t used = 0;
+			for (const auto& e : _entries) {
+				if (e._offset != _Align_up(used, e._ops->_align)) {
+					return true;
+				}
+				used = e._offset + e._ops->_size;
+			}
+			return false;
+		}
+
+		void _Relocate_into(unsigned char* buf, size_type skip) noexcept {
+			std::size_t used = 0;
+			size_type out = 0;
+			for (size_type i = 0; i < _entries.size(); ++i) {
+				if (i == skip) {
+					continue;
+				}
+				_Poly_entry<Base> e = _entries[i];
+				std::size_t offset = _Align_up(used, e._ops->_align);
+				e._base = e._ops->_relocate(buf + offset, _buf + e._offset);
+				e._offset = offset;
+				_entries[out++] = e;
+				used = offset + e._ops->_size;
+			}
+			_entries.resize(out);
+			_used = used;
+		}
+
+		unsigned char* _buf;
+		std::size_t _used;
+		std::size_t _capacity;
+		std::vector<_Poly_entry<Base>> _entries;
+	};
+}
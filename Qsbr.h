@@ -0,0 +1,225 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Rainbow3D {
+
+	inline constexpr std::uint64_t _Qsbr_offline = (std::numeric_limits<std::uint64_t>::max)();
+
+	struct alignas(64) _Qsbr_thread_record {
+		std::atomic<std::uint64_t> _epoch{ _Qsbr_offline };
+		bool _registered = false;
+	};
+
+	struct _Qsbr_retired_node {
+		void* _ptr;
+		void (*_reclaim)(void*);
+		std::uint64_t _epoch;
+	};
+
+	class QsbrThread;
+
+	//Quiescent-state-based reclamation. Registered threads announce the global epoch they have
+	//seen each time they pass a quiescent point, and a retired object is freed once every online
+	//thread has announced an epoch at least as new as the one it was retired in. Readers pay
+	//nothing; offline threads are skipped so idle threads do not hold back reclamation.
+	class QsbrDomain {
+	public:
+		explicit QsbrDomain(std::size_t threshold = 64) noexcept : _threshold(threshold) {}
+
+		QsbrDomain(const QsbrDomain&) = delete;
+		QsbrDomain& operator=(const QsbrDomain&) = delete;
+
+		//All threads must have been unregistered before the domain.
+		~QsbrDomain() {
+			for (auto& r : _retired) {
+				r._reclaim(r._ptr);
+			}
+		}
+
+		static QsbrDomain& Default() noexcept {
+			static QsbrDomain domain;
+			return domain;
+		}
+
+		//Registers the calling thread. The thread starts online.
+		QsbrThread Register();
+
+		void Retire(void* p, void (*reclaim)(void*)) {
+			std::uint64_t epoch = _epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+			std::unique_lock<std::mutex> lock(_mutex);
+			_retired.push_back({ p, reclaim, epoch });
+			if (_retired.size() >= _threshold) {
+				_Reclaim(lock);
+			}
+		}
+
+		template<typename T, typename Deleter = _Default_delete_t<T>>
+		requires std::is_empty_v<Deleter> && std::is_default_constructible_v<Deleter>
+		void Retire(T* p) {
+			Retire(p, [](void* q) { Deleter()(static_cast<T*>(q)); });
+		}
+
+		//Frees every retired object whose grace period has elapsed.
+		void Reclaim() {
+			std::unique_lock<std::mutex> lock(_mutex);
+			_Reclaim(lock);
+		}
+
+		std::size_t RetiredCount() const {
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _retired.size();
+		}
+
+	private:
+		friend class QsbrThread;
+
+		void _Reclaim(std::unique_lock<std::mutex>& lock) {
+			std::uint64_t safe = _Qsbr_offline;
+			for (auto& rec : _threads) {
+				if (rec->_registered) {
+					std::uint64_t epoch = rec->_epoch.load(std::memory_order_seq_cst);
+					if (epoch < safe) {
+						safe = epoch;
+					}
+				}
+			}
+
+			std::vector<_Qsbr_retired_node> reclaimable;
+			std::size_t kept = 0;
+			for (auto& r : _retired) {
+				if (r._epoch <= safe) {
+					reclaimable.push_back(r);
+				}
+				else {
+					_retired[kept++] = r;
+				}
+			}
+			_retired.resize(kept);
+
+			lock.unlock();
+			for (auto& r : reclaimable) {
+				r._reclaim(r._ptr);
+			}
+			lock.lock();
+		}
+
+		_Qsbr_thread_record* _Register() {
+			std::lock_guard<std::mutex> lock(_mutex);
+			_Qsbr_thread_record* rec = nullptr;
+			for (auto& r : _threads) {
+				if (!r->_registered) {
+					rec = r.get();
+					break;
+				}
+			}
+			if (!rec) {
+				_threads.push_back(std::make_unique<_Qsbr_thread_record>());
+				rec = _threads.back().get();
+			}
+			rec->_registered = true;
+			rec->_epoch.store(_epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+			return rec;
+		}
+
+		void _Unregister(_Qsbr_thread_record* rec) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			rec->_epoch.store(_Qsbr_offline, std::memory_order_release);
+			rec->_registered = false;
+		}
+
+		std::atomic<std::uint64_t> _epoch{ 1 };
+		mutable std::mutex _mutex;
+		std::vector<std::unique_ptr<_Qsbr_thread_record>> _threads;
+		std::vector<_Qsbr_retired_node> _retired;
+		std::size_t _threshold;
+	};
+
+	//Registration of one thread with a QsbrDomain; unregisters on destruction.
+	class QsbrThread {
+	public:
+		QsbrThread() noexcept : _domain(nullptr), _rec(nullptr) {}
+
+		QsbrThread(const QsbrThread&) = delete;
+		QsbrThread& operator=(const QsbrThread&) = delete;
+
+		QsbrThread(QsbrThread&& r) noexcept : _domain(std::exchange(r._domain, nullptr)), _rec(std::exchange(r._rec, nullptr)) {}
+
+		QsbrThread& operator=(QsbrThread&& r) noexcept {
+			if (this != std::addressof(r)) {
+				Reset();
+				_domain = std::exchange(r._domain, nullptr);
+				_rec = std::exchange(r._rec, nullptr);
+			}
+			return *this;
+		}
+
+		~QsbrThread() {
+			Reset();
+		}
+
+		void Reset() noexcept {
+			if (_rec) {
+				_domain->_Unregister(_rec);
+				_domain = nullptr;
+				_rec = nullptr;
+			}
+		}
+
+		//Declares that the thread holds no references to shared objects.
+		void Quiescent() noexcept {
+			_rec->_epoch.store(_domain->_epoch.load(std::memory_order_acquire), std::memory_order_release);
+		}
+
+		//Takes the thread out of grace period tracking until Online() is called, e.g. before blocking.
+		void Offline() noexcept {
+			_rec->_epoch.store(_Qsbr_offline, std::memory_order_release);
+		}
+
+		void Online() noexcept {
+			_rec->_epoch.store(_domain->_epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+		}
+
+		bool IsOnline() const noexcept {
+			return _rec->_epoch.load(std::memory_order_relaxed) != _Qsbr_offline;
+		}
+
+		explicit operator bool() const noexcept {
+			return _rec != nullptr;
+		}
+
+	private:
+		friend class QsbrDomain;
+
+		QsbrThread(QsbrDomain* domain, _Qsbr_thread_record* rec) noexcept : _domain(domain), _rec(rec) {}
+
+		QsbrDomain* _domain;
+		_Qsbr_thread_record* _rec;
+	};
+
+	inline QsbrThread QsbrDomain::Register() {
+		return QsbrThread(this, _Register());
+	}
+
+	//Deleter that defers destruction until every online thread of the domain has passed a
+	//quiescent state. UniquePtr runs deleters from noexcept Reset() and destructors, so this is
+	//noexcept too: if Retire() cannot grow the retired list, std::terminate is called. Unlike
+	//HazardRetire there is no synchronous fallback, since waiting for a grace period on a thread
+	//that is itself online in the domain would never finish.
+	template<typename T, typename Deleter = _Default_delete_t<T>>
+	struct QsbrRetire {
+		QsbrDomain* domain = &QsbrDomain::Default();
+
+		void operator()(T* p) const noexcept {
+			domain->template Retire<T, Deleter>(p);
+		}
+	};
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Rainbow3D {
+
+	//Per-thread reader record. _period is the grace period the thread saw when it entered its
+	//outermost read-side section, or 0 outside one; only the owning thread writes it, so readers
+	//never share a cache line. _nesting is private to the owning thread.
+	struct alignas(64) _Rcu_reader_record {
+		std::atomic<std::uint64_t> _period{ 0 };
+		unsigned int _nesting = 0;
+	};
+
+	//Process-wide grace period counter and the records of every thread that has read.
+	struct _Rcu_registry {
+		std::atomic<std::uint64_t> _period{ 1 };
+		std::mutex _mutex;
+		std::vector<_Rcu_reader_record*> _readers;
+
+		//Never destroyed: reader threads may unregister after static destruction has begun.
+		static _Rcu_registry& Get() noexcept {
+			static _Rcu_registry* registry = new _Rcu_registry;
+			return *registry;
+		}
+	};
+
+	struct _Rcu_thread_state {
+		_Rcu_reader_record* _rec = nullptr;
+
+		~_Rcu_thread_state() {
+			if (_rec) {
+				_Rcu_registry& registry = _Rcu_registry::Get();
+				std::lock_guard<std::mutex> lock(registry._mutex);
+				registry._readers.erase(std::find(registry._readers.begin(), registry._readers.end(), _rec));
+				delete _rec;
+			}
+		}
+	};
+
+	inline _Rcu_thread_state& _Rcu_thread() noexcept {
+		thread_local _Rcu_thread_state state;
+		return state;
+	}
+
+	//Enters a read-side section on the calling thread, registering it on first use.
+	inline _Rcu_reader_record* _Rcu_read_lock() {
+		_Rcu_thread_state& state = _Rcu_thread();
+		if (!state._rec) {
+			_Rcu_registry& registry = _Rcu_registry::Get();
+			auto rec = std::make_unique<_Rcu_reader_record>();
+			std::lock_guard<std::mutex> lock(registry._mutex);
+			registry._readers.push_back(rec.get());
+			state._rec = rec.release();
+		}
+		_Rcu_reader_record* rec = state._rec;
+		if (rec->_nesting++ == 0) {
+			rec->_period.store(_Rcu_registry::Get()._period.load(std::memory_order_relaxed), std::memory_order_release);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+		return rec;
+	}
+
+	inline void _Rcu_read_unlock(_Rcu_reader_record* rec) noexcept {
+		if (--rec->_nesting == 0) {
+			rec->_period.store(0, std::memory_order_release);
+		}
+	}
+
+	//Waits until every read-side section, on any RcuPtr, that started before the call has ended.
+	inline void _Rcu_synchronize() {
+		[[maybe_unused]] _Rcu_thread_state& state = _Rcu_thread();
+		assert((!state._rec || state._rec->_nesting == 0) && "waiting for a grace period inside a read-side section deadlocks");
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		_Rcu_registry& registry = _Rcu_registry::Get();
+		std::lock_guard<std::mutex> lock(registry._mutex);
+		std::uint64_t period = registry._period.fetch_add(1, std::memory_order_seq_cst) + 1;
+		for (_Rcu_reader_record* rec : registry._readers) {
+			for (;;) {
+				std::uint64_t seen = rec->_period.load(std::memory_order_acquire);
+				if (seen == 0 || seen >= period) {
+					break;
+				}
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	template<typename T>
+	class RcuReadGuard;
+
+	//Read-copy-update pointer. Each thread has its own reader record: the outermost Read() stores
+	//the current grace period into it and issues one full fence (an mfence or locked instruction
+	//on x86), nested reads and the guard's release are plain thread-local operations, and no
+	//shared cache line is written. Readers that must cost no more than a load should use
+	//QsbrDomain instead. Writers publish a new version with a single exchange and wait for every
+	//reader that might still see the old one before destroying it. Grace periods are
+	//process-wide, so Publish() and Synchronize() also wait for readers of other RcuPtrs, and
+	//calling either while the calling thread holds an RcuReadGuard would wait forever (asserted).
+	template<typename T, typename Deleter = _Default_delete_t<T>>
+	class RcuPtr {
+	public:
+		using element_type = T;
+		using deleter_type = Deleter;
+		using pointer = T*;
+
+		RcuPtr() noexcept = default;
+
+		explicit RcuPtr(UniquePtr<T, Deleter>&& p) noexcept : _current(p.Get()), _d(std::move(p.GetDeleter())) {
+			p.Release();
+		}
+
+		RcuPtr(const RcuPtr&) = delete;
+		RcuPtr& operator=(const RcuPtr&) = delete;
+
+		//No read guard may outlive the RcuPtr.
+		~RcuPtr() {
+			if (pointer p = _current.load(std::memory_order_relaxed)) {
+				_d(p);
+			}
+		}
+
+		//Guards must be destroyed on the thread that created them. The first Read() on a thread
+		//registers it and may throw std::bad_alloc.
+		RcuReadGuard<T> Read() const {
+			_Rcu_reader_record* rec = _Rcu_read_lock();
+			return RcuReadGuard<T>(_current.load(std::memory_order_acquire), rec);
+		}
+
+		//Publishes p and returns the previous version once no reader can still observe it.
+		UniquePtr<T, Deleter> Publish(UniquePtr<T, Deleter>&& p) {
+			std::lock_guard<std::mutex> lock(_writer);
+			pointer old = _current.exchange(p.Release(), std::memory_order_acq_rel);
+			_Rcu_synchronize();
+			return UniquePtr<T, Deleter>(old, _d);
+		}
+
+		//Waits until every read-side section that started before the call has finished.
+		void Synchronize() {
+			_Rcu_synchronize();
+		}
+
+		pointer Get() const noexcept {
+			return _current.load(std::memory_order_acquire);
+		}
+
+	private:
+		std::atomic<pointer> _current{ nullptr };
+		std::mutex _writer;
+		deleter_type _d;
+	};
+
+	template<typename T>
+	class RcuReadGuard {
+	public:
+		RcuReadGuard(const RcuReadGuard&) = delete;
+		RcuReadGuard& operator=(const RcuReadGuard&) = delete;
+
+		RcuReadGuard(RcuReadGuard&& r) noexcept : _ptr(std::exchange(r._ptr, nullptr)), _rec(std::exchange(r._rec, nullptr)) {}
+
+		RcuReadGuard& operator=(RcuReadGuard&&) = delete;
+
+		~RcuReadGuard() {
+			if (_rec) {
+				_Rcu_read_unlock(_rec);
+			}
+		}
+
+		T* Get() const noexcept {
+			return _ptr;
+		}
+
+		explicit operator bool() const noexcept {
+			return Get() != nullptr;
+		}
+
+		T* operator->() const noexcept {
+			return Get();
+		}
+
+		T& operator*() const noexcept {
+			return *_ptr;
+		}
+
+	private:
+		template<typename U, typename E>
+		friend class RcuPtr;
+
+		RcuReadGuard(T* p, _Rcu_reader_record* rec) noexcept : _ptr(p), _rec(rec) {}
+
+		T* _ptr;
+		_Rcu_reader_record* _rec;
+	};
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace Rainbow3D {
+
+	//Header in front of every block handed out by a SegmentAllocator. _segment is the address of
+	//the owning segment relative to the block itself, so freeing works wherever the region is
+	//mapped and needs no allocator reference.
+	struct _Segment_block {
+		std::int64_t _segment;
+		std::uint32_t _class;
+		std::uint32_t _reserved;
+	};
+
+	//Allocator living at the start of a (typically memory-mapped) region and managing the rest
+	//of it. All of its state is offsets from its own address, so the same region can be mapped
+	//at different addresses, by several processes at once, or saved and mapped again later.
+	//Blocks come from power-of-two size classes, each with its own free list, and are carved off
+	//a bump pointer when the list is empty. A spinlock in the header serializes allocation across
+	//every process sharing the region. Blocks are 16-byte aligned.
+	class SegmentAllocator {
+		static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "the segment lock has to be address-free");
+
+	public:
+		static constexpr std::size_t max_align = 16;
+
+		SegmentAllocator(const SegmentAllocator&) = delete;
+		SegmentAllocator& operator=(const SegmentAllocator&) = delete;
+
+		//Lays out a fresh segment over [base, base + size).
+		static SegmentAllocator* Format(void* base, std::size_t size) {
+			if (size < _Header_size()) {
+				throw std::invalid_argument("region is too small for a segment");
+			}
+			return ::new (base) SegmentAllocator(size);
+		}
+
+		//Returns the segment previously formatted over base.
+		static SegmentAllocator* Attach(void* base, std::size_t size) {
+			SegmentAllocator* s = std::launder(static_cast<SegmentAllocator*>(base));
+			if (s->_magic != _Magic || s->_size > size) {
+				throw std::invalid_argument("region does not hold a segment");
+			}
+			return s;
+		}
+
+		void* Allocate(std::size_t bytes, std::size_t align = max_align) {
+			if (align > max_align) {
+				throw std::invalid_argument("SegmentAllocator alignment is limited to 16 bytes");
+			}
+			std::uint32_t cls = _Class_of(bytes + sizeof(_Segment_block));
+			if (cls >= _Classes) {
+				throw std::bad_alloc();
+			}
+			std::uint64_t block_size = std::uint64_t(1) << (cls + _Min_shift);
+			std::uint64_t offset;
+			_Lock();
+			if (_free[cls]) {
+				offset = _free[cls];
+				_free[cls] = *reinterpret_cast<std::uint64_t*>(_At(offset) + sizeof(_Segment_block));
+			}
+			else {
+				if (block_size > _size - _bump) {
+					_Unlock();
+					throw std::bad_alloc();
+				}
+				offset = _bump;
+				_bump += block_size;
+			}
+			_Unlock();
+			_Segment_block* block = ::new (static_cast<void*>(_At(offset))) _Segment_block{ 0, cls, 0 };
+			block->_segment = reinterpret_cast<unsigned char*>(this) - reinterpret_cast<unsigned char*>(block);
+			return block + 1;
+		}
+
+		//Frees a block from whichever segment it came from.
+		static void Deallocate(void* p) noexcept {
+			if (!p) {
+				return;
+			}
+			SegmentAllocator* s = Of(p);
+			s->_Lock();
+			s->_Push_free(p);
+			s->_Unlock();
+		}
+
+		//Frees n blocks, taking each segment's lock once per run of blocks from that segment, so
+		//address-sorted batches pay for one lock per segment.
+		template<typename P>
+		static void DeallocateBatch(P* const* ptrs, std::size_t n) noexcept {
+			SegmentAllocator* locked = nullptr;
+			for (std::size_t i = 0; i < n; ++i) {
+				void* p = const_cast<void*>(static_cast<const void*>(ptrs[i]));
+				if (!p) {
+					continue;
+				}
+				SegmentAllocator* s = Of(p);
+				if (s != locked) {
+					if (locked) {
+						locked->_Unlock();
+					}
+					locked = s;
+					locked->_Lock();
+				}
+				locked->_Push_free(p);
+			}
+			if (locked) {
+				locked->_Unlock();
+			}
+		}
+
+		//The segment a block was allocated from.
+		static SegmentAllocator* Of(void* p) noexcept {
+			_Segment_block* block = static_cast<_Segment_block*>(p) - 1;
+			return reinterpret_cast<SegmentAllocator*>(reinterpret_cast<unsigned char*>(block) + block->_segment);
+		}
+
+		//The root is the entry point of the graph stored in the segment, kept as an offset.
+		void SetRoot(const void* p) noexcept {
+			_root = p ? static_cast<std::uint64_t>(static_cast<const unsigned char*>(p) - reinterpret_cast<unsigned char*>(this)) : 0;
+		}
+
+		void* GetRoot() noexcept {
+			return _root ? _At(_root) : nullptr;
+		}
+
+		//Converts between addresses inside the segment and offsets from its start.
+		std::uint64_t OffsetOf(const void* p) const noexcept {
+			return static_cast<std::uint64_t>(static_cast<const unsigned char*>(p) - reinterpret_cast<const unsigned char*>(this));
+		}
+
+		void* AddressOf(std::uint64_t offset) noexcept {
+			return _At(offset);
+		}
+
+		//True when offset could be the start of a block handed out by this segment, holding at
+		//least bytes: it has to lie in the allocated part and carry a block header that names this
+		//segment and a size class the block fits in. Used to vet offsets received from elsewhere;
+		//an offset into the middle of a block is only caught if its bytes do not look like a header.
+		bool HoldsBlock(std::uint64_t offset, std::size_t bytes) noexcept {
+			if (offset < _Header_size() + sizeof(_Segment_block) || offset % max_align != 0) {
+				return false;
+			}
+			_Lock();
+			std::uint64_t bump = _bump;
+			_Unlock();
+			if (offset > bump) {
+				return false;
+			}
+			std::uint64_t header = offset - sizeof(_Segment_block);
+			_Segment_block block;
+			std::memcpy(&block, _At(header), sizeof(block));
+			if (block._class >= _Classes || block._segment != -static_cast<std::int64_t>(header)) {
+				return false;
+			}
+			std::uint64_t block_size = std::uint64_t(1) << (block._class + _Min_shift);
+			return block_size <= bump - header && bytes <= block_size - sizeof(_Segment_block);
+		}
+
+		std::size_t Size() const noexcept {
+			return static_cast<std::size_t>(_size);
+		}
+
+		std::size_t Used() const noexcept {
+			return static_cast<std::size_t>(_bump);
+		}
+
+	private:
+		static constexpr std::uint64_t _Magic = 0x52334453454732ull;
+		static constexpr unsigned _Min_shift = 5;
+		static constexpr unsigned _Classes = 48;
+
+		explicit SegmentAllocator(std::size_t size) noexcept : _magic(_Magic), _size(size), _bump(_Header_size()), _root(0), _free{} {}
+
+		static constexpr std::size_t _Header_size() noexcept {
+			return (sizeof(SegmentAllocator) + 63) & ~std::size_t(63);
+		}
+
+		static std::uint32_t _Class_of(std::size_t bytes) noexcept {
+			unsigned shift = static_cast<unsigned>(std::bit_width(bytes - 1));
+			return shift <= _Min_shift ? 0 : shift - _Min_shift;
+		}
+
+		unsigned char* _At(std::uint64_t offset) noexcept {
+			return reinterpret_cast<unsigned char*>(this) + offset;
+		}
+
+		void _Push_free(void* p) noexcept {
+			_Segment_block* block = static_cast<_Segment_block*>(p) - 1;
+			*static_cast<std::uint64_t*>(p) = _free[block->_class];
+			_free[block->_class] = OffsetOf(block);
+		}
+
+		void _Lock() noexcept {
+			while (_lock.exchange(1, std::memory_order_acquire)) {
+				while (_lock.load(std::memory_order_relaxed)) {
+				}
+			}
+		}
+
+		void _Unlock() noexcept {
+			_lock.store(0, std::memory_order_release);
+		}
+
+		std::uint64_t _magic;
+		std::uint64_t _size;
+		std::uint64_t _bump;
+		std::uint64_t _root;
+		std::atomic<std::uint32_t> _lock{ 0 };
+		std::uint64_t _free[_Classes];
+	};
+}
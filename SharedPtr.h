@@ -0,0 +1,230 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Rainbow3D {
+
+	//Default count policy for SharedPtr: one atomic use count. A count policy is the base of the
+	//control block and starts out holding the creating handle's reference. Every handle carries
+	//the ticket_type its reference was counted under (empty unless the policy splits the count)
+	//and gets it from Ticket() on the thread that creates the handle.
+	struct SharedAtomicCount {
+		struct ticket_type {};
+
+		static ticket_type Ticket() noexcept {
+			return {};
+		}
+
+		void Increment(ticket_type, long n = 1) noexcept {
+			_uses.fetch_add(n, std::memory_order_relaxed);
+		}
+
+		//Returns true when the last reference is gone.
+		bool Decrement(ticket_type, long n = 1) noexcept {
+			return _uses.fetch_sub(n, std::memory_order_acq_rel) == n;
+		}
+
+		long Count() const noexcept {
+			return _uses.load(std::memory_order_relaxed);
+		}
+
+		std::atomic<long> _uses{ 1 };
+	};
+
+	//A policy that has to free objects outside Decrement() (BiasedCount merging counts queued by
+	//other threads) declares _Destroy() itself; the control block overrides it.
+	template<typename T, typename CountPolicy>
+	struct _Shared_control_block : CountPolicy {
+		using _Ticket = typename CountPolicy::ticket_type;
+
+		T* _ptr = nullptr;
+
+		virtual void _Destroy() noexcept = 0;
+
+		void _Incref(_Ticket t) noexcept {
+			this->Increment(t);
+		}
+
+		void _Decref(_Ticket t) noexcept {
+			if (this->Decrement(t)) {
+				_Destroy();
+			}
+		}
+
+	protected:
+		~_Shared_control_block() = default;
+	};
+
+	template<typename T, typename CountPolicy, typename Deleter>
+	struct _Shared_control_block_deleter final : _Shared_control_block<T, CountPolicy> {
+		_Shared_control_block_deleter(T* p, Deleter&& d) noexcept : _d(std::move(d)) {
+			this->_ptr = p;
+		}
+
+		void _Destroy() noexcept override {
+			_d(this->_ptr);
+			delete this;
+		}
+
+		Deleter _d;
+	};
+
+	template<typename T, typename CountPolicy>
+	struct _Shared_control_block_inplace final : _Shared_control_block<T, CountPolicy> {
+		template<typename... Args>
+		explicit _Shared_control_block_inplace(Args&&... args) {
+			this->_ptr = ::new (static_cast<void*>(&_storage)) T(std::forward<Args>(args)...);
+		}
+
+		void _Destroy() noexcept override {
+			this->_ptr->~T();
+			delete this;
+		}
+
+		alignas(T) unsigned char _storage[sizeof(T)];
+	};
+
+	template<typename T>
+	class AtomicSharedPtr;
+
+	//Shared-ownership pointer. How references are counted is a compile-time CountPolicy, so the
+	//choice costs no branch on copies: SharedAtomicCount (default), BiasedCount or
+	//StripedCount<N>. The control block always records the owned object as a T*, which is what
+	//lets AtomicSharedPtr<T> publish it in a single word.
+	template<typename T, typename CountPolicy = SharedAtomicCount>
+	class SharedPtr {
+	public:
+		using element_type = T;
+		using pointer = T*;
+		using count_policy = CountPolicy;
+
+		constexpr SharedPtr() noexcept : _ptr(nullptr), _rep(nullptr), _ticket() {}
+
+		constexpr SharedPtr(std::nullptr_t) noexcept : _ptr(nullptr), _rep(nullptr), _ticket() {}
+
+		explicit SharedPtr(pointer p) : SharedPtr(UniquePtr<T>(p)) {}
+
+		template <typename U, typename E>
+		requires std::is_convertible_v<typename UniquePtr<U, E>::pointer, pointer> && std::is_move_constructible_v<E> && (!std::is_array_v<U>)
+		SharedPtr(UniquePtr<U, E>&& r) : _ptr(nullptr), _rep(nullptr), _ticket() {
+			if (r) {
+				using deleter_type = std::remove_reference_t<E>;
+				auto rep = new _Shared_control_block_deleter<T, CountPolicy, _Shared_deleter_adaptor<U, deleter_type>>(r.Get(), _Shared_deleter_adaptor<U, deleter_type>{ r.Get(), std::forward<E>(r.GetDeleter()) });
+				r.Release();
+				_Adopt(rep);
+			}
+		}
+
+		SharedPtr(const SharedPtr& r) noexcept : _ptr(r._ptr), _rep(r._rep), _ticket(CountPolicy::Ticket()) {
+			if (_rep) {
+				_rep->_Incref(_ticket);
+			}
+		}
+
+		SharedPtr(SharedPtr&& r) noexcept : _ptr(std::exchange(r._ptr, nullptr)), _rep(std::exchange(r._rep, nullptr)), _ticket(r._ticket) {}
+
+		~SharedPtr() {
+			if (_rep) {
+				_rep->_Decref(_ticket);
+			}
+		}
+
+		SharedPtr& operator=(const SharedPtr& r) noexcept {
+			SharedPtr(r).Swap(*this);
+			return *this;
+		}
+
+		SharedPtr& operator=(SharedPtr&& r) noexcept {
+			SharedPtr(std::move(r)).Swap(*this);
+			return *this;
+		}
+
+		SharedPtr& operator=(std::nullptr_t) noexcept {
+			Reset();
+			return *this;
+		}
+
+		void Reset() noexcept {
+			SharedPtr().Swap(*this);
+		}
+
+		void Reset(pointer p) {
+			SharedPtr(p).Swap(*this);
+		}
+
+		void Swap(SharedPtr& other) noexcept {
+			std::swap(_ptr, other._ptr);
+			std::swap(_rep, other._rep);
+			std::swap(_ticket, other._ticket);
+		}
+
+		pointer Get() const noexcept {
+			return _ptr;
+		}
+
+		long UseCount() const noexcept {
+			return _rep ? _rep->Count() : 0;
+		}
+
+		explicit operator bool() const noexcept {
+			return Get() != nullptr;
+		}
+
+		pointer operator->() const noexcept {
+			return Get();
+		}
+
+		std::add_lvalue_reference_t<T> operator*() const noexcept {
+			return *_ptr;
+		}
+
+		friend bool operator==(const SharedPtr& l, const SharedPtr& r) noexcept {
+			return l._rep == r._rep;
+		}
+
+		friend bool operator==(const SharedPtr& l, std::nullptr_t) noexcept {
+			return l._rep == nullptr;
+		}
+
+	private:
+		template<typename U>
+		friend class AtomicSharedPtr;
+
+		template<typename U, typename P, typename... Args>
+		friend SharedPtr<U, P> MakeShared(Args&&... args);
+
+		template<typename U, typename E>
+		struct _Shared_deleter_adaptor {
+			typename UniquePtr<U, E>::pointer _owned;
+			E _d;
+
+			void operator()(T*) noexcept {
+				_d(_owned);
+			}
+		};
+
+		//Takes over the reference a new control block was created with on this thread.
+		void _Adopt(_Shared_control_block<T, CountPolicy>* rep) noexcept {
+			_rep = rep;
+			_ptr = rep->_ptr;
+			_ticket = CountPolicy::Ticket();
+		}
+
+		pointer _ptr;
+		_Shared_control_block<T, CountPolicy>* _rep;
+		RAINBOW3D_NO_UNIQUE_ADDRESS typename CountPolicy::ticket_type _ticket;
+	};
+
+	template<typename T, typename CountPolicy = SharedAtomicCount, typename... Args>
+	SharedPtr<T, CountPolicy> MakeShared(Args&&... args) {
+		SharedPtr<T, CountPolicy> r;
+		r._Adopt(new _Shared_control_block_inplace<T, CountPolicy>(std::forward<Args>(args)...));
+		return r;
+	}
+}
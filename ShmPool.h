@@ -0,0 +1,230 @@
+#pragma once
+
+#if defined(_WIN32)
+#error "ShmPool.h needs POSIX shared memory (shm_open)"
+#endif
+
+#include "UniquePtr.h"
+#include "SegmentAllocator.h"
+#include "MappedRegion.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <system_error>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+namespace Rainbow3D {
+
+	//Destroys an object living in a shared-memory segment and returns its block. Stateless, and
+	//valid in any process that has the segment mapped, wherever it is mapped.
+	template<typename T>
+	struct ShmDeleter {
+		void operator()(T* p) const noexcept {
+			p->~T();
+			SegmentAllocator::Deallocate(p);
+		}
+
+		//Runs all destructors, then returns the blocks under one lock per segment.
+		void DeleteBatch(T* const* ptrs, std::size_t n) const noexcept {
+			for (std::size_t i = 0; i < n; ++i) {
+				ptrs[i]->~T();
+			}
+			SegmentAllocator::DeallocateBatch(ptrs, n);
+		}
+	};
+
+	//Arrays carry no element count, so only trivially destructible elements are supported.
+	template<typename T>
+	struct ShmDeleter<T[]> {
+		static_assert(std::is_trivially_destructible_v<T>, "shared-memory arrays need trivially destructible elements");
+
+		void operator()(T* p) const noexcept {
+			SegmentAllocator::Deallocate(p);
+		}
+
+		void DeleteBatch(T* const* ptrs, std::size_t n) const noexcept {
+			SegmentAllocator::DeallocateBatch(ptrs, n);
+		}
+	};
+
+	//Names an object in a shared-memory pool independently of where any process maps it.
+	struct ShmHandle {
+		std::uint32_t segment;
+		std::uint64_t offset;
+	};
+
+	struct _Shm_pool_header {
+		std::uint64_t _magic;
+		std::uint32_t _id;
+	};
+
+	//Pool of objects in a POSIX shared-memory object (shm_open + mmap), allocated through a
+	//SegmentAllocator and owned through UniquePtr<T, ShmDeleter<T>>. To pass an object to another
+	//process, Transfer() turns the owner into a ShmHandle, which is sent by any means and turned
+	//back into an owner with Receive() on the other side; the bytes themselves never move. The
+	//pool has to stay mapped while any of its objects is alive in this process.
+	class ShmPool {
+	public:
+		ShmPool() noexcept : _segment(nullptr), _id(0) {}
+
+		ShmPool(const ShmPool&) = delete;
+		ShmPool& operator=(const ShmPool&) = delete;
+
+		ShmPool(ShmPool&& r) noexcept : _region(std::move(r._region)), _segment(std::exchange(r._segment, nullptr)), _id(r._id), _name(std::move(r._name)) {}
+
+		ShmPool& operator=(ShmPool&& r) noexcept {
+			if (this != &r) {
+				_region = std::move(r._region);
+				_segment = std::exchange(r._segment, nullptr);
+				_id = r._id;
+				_name = std::move(r._name);
+			}
+			return *this;
+		}
+
+		//Creates a new shared-memory object of size bytes; id is carried in every ShmHandle.
+		static ShmPool Create(const char* name, std::size_t size, std::uint32_t id) {
+			if (size <= _Header_size) {
+				throw std::invalid_argument("shared-memory pool is too small");
+			}
+			int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+			if (fd < 0) {
+				throw std::system_error(errno, std::system_category(), "shm_open");
+			}
+			//From here on the name is ours, so any failure must remove it again or every later
+			//Create() with it fails with EEXIST.
+			ShmPool pool;
+			try {
+				pool._region = _Map(fd, size, true);
+				pool._segment = SegmentAllocator::Format(static_cast<unsigned char*>(pool._region.Data()) + _Header_size, size - _Header_size);
+			}
+			catch (...) {
+				::shm_unlink(name);
+				throw;
+			}
+			//The header goes last so that Open() never sees a half-formatted pool.
+			::new (pool._region.Data()) _Shm_pool_header{ _Magic, id };
+			pool._id = id;
+			pool._name = name;
+			return pool;
+		}
+
+		//Maps a pool created by another process.
+		static ShmPool Open(const char* name) {
+			ShmPool pool;
+			pool._region = _Map(::shm_open(name, O_RDWR, 0), 0, false);
+			if (pool._region.Size() < _Header_size) {
+				throw std::invalid_argument("shared-memory object does not hold a pool");
+			}
+			const _Shm_pool_header* header = std::launder(static_cast<const _Shm_pool_header*>(pool._region.Data()));
+			if (header->_magic != _Magic) {
+				throw std::invalid_argument("shared-memory object does not hold a pool");
+			}
+			pool._segment = SegmentAllocator::Attach(static_cast<unsigned char*>(pool._region.Data()) + _Header_size, pool._region.Size() - _Header_size);
+			pool._id = header->_id;
+			pool._name = name;
+			return pool;
+		}
+
+		//Removes the name; mappings that already exist stay valid.
+		void Unlink() {
+			if (::shm_unlink(_name.c_str()) != 0) {
+				throw std::system_error(errno, std::system_category(), "shm_unlink");
+			}
+		}
+
+		template<typename T, typename... Args>
+		requires (!std::is_array_v<T>)
+		UniquePtr<T, ShmDeleter<T>> Make(Args&&... args) {
+			static_assert(!std::is_polymorphic_v<T>, "objects in shared memory cannot hold vtable pointers");
+			static_assert(alignof(T) <= SegmentAllocator::max_align, "SegmentAllocator alignment is limited to 16 bytes");
+			void* mem = _segment->Allocate(sizeof(T), alignof(T));
+			T* p;
+			try {
+				p = ::new (mem) T(std::forward<Args>(args)...);
+			}
+			catch (...) {
+				SegmentAllocator::Deallocate(mem);
+				throw;
+			}
+			return UniquePtr<T, ShmDeleter<T>>(p);
+		}
+
+		//Default-initialized array, e.g. a frame buffer.
+		template<typename T>
+		requires std::is_unbounded_array_v<T>
+		UniquePtr<T, ShmDeleter<T>> Make(std::size_t count) {
+			using E = std::remove_extent_t<T>;
+			static_assert(alignof(E) <= SegmentAllocator::max_align, "SegmentAllocator alignment is limited to 16 bytes");
+			if (count > (static_cast<std::size_t>(-1) - SegmentAllocator::max_align) / sizeof(E)) {
+				throw std::bad_array_new_length();
+			}
+			void* mem = _segment->Allocate(sizeof(E) * count, alignof(E));
+			return UniquePtr<T, ShmDeleter<T>>(::new (mem) E[count]);
+		}
+
+		//Gives up ownership in this process; exactly one process must Receive the handle. Throws
+		//std::invalid_argument, leaving p untouched, when p is null or owns a block of another pool.
+		template<typename T>
+		ShmHandle Transfer(UniquePtr<T, ShmDeleter<T>>&& p) {
+			if (!p || SegmentAllocator::Of(p.Get()) != _segment) {
+				throw std::invalid_argument("only objects allocated from this pool can be transferred");
+			}
+			return ShmHandle{ _id, _segment->OffsetOf(p.Release()) };
+		}
+
+		//Handles come from another process, so the offset is checked against the allocated part
+		//of the segment before it is turned into a pointer.
+		template<typename T>
+		UniquePtr<T, ShmDeleter<T>> Receive(ShmHandle h) {
+			if (h.segment != _id) {
+				throw std::invalid_argument("handle belongs to another pool");
+			}
+			if (!_segment->HoldsBlock(h.offset, sizeof(std::remove_extent_t<T>))) {
+				throw std::out_of_range("handle offset is outside the pool's allocated blocks");
+			}
+			return UniquePtr<T, ShmDeleter<T>>(static_cast<std::remove_extent_t<T>*>(_segment->AddressOf(h.offset)));
+		}
+
+		SegmentAllocator& Segment() const noexcept {
+			return *_segment;
+		}
+
+		std::uint32_t Id() const noexcept {
+			return _id;
+		}
+
+		explicit operator bool() const noexcept {
+			return _segment != nullptr;
+		}
+
+	private:
+		static constexpr std::uint64_t _Magic = 0x52334453484d50ull;
+		static constexpr std::size_t _Header_size = 64;
+
+		static MappedRegion _Map(int fd, std::size_t size, bool resize) {
+			if (fd < 0) {
+				throw std::system_error(errno, std::system_category(), "shm_open");
+			}
+			try {
+				return MappedRegion::MapDescriptor(fd, size, resize);
+			}
+			catch (...) {
+				::close(fd);
+				throw;
+			}
+		}
+
+		MappedRegion _region;
+		SegmentAllocator* _segment;
+		std::uint32_t _id;
+		std::string _name;
+	};
+}
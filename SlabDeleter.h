@@ -0,0 +1,99 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace Rainbow3D {
+
+	//Header at the front of a MakeUniqueBatch slab: how many objects are still alive, and what
+	//the block has to be freed with.
+	struct _Slab_header {
+		std::atomic<std::size_t> _live;
+		std::size_t _bytes;
+		std::size_t _align;
+	};
+
+	inline void _Free_slab(_Slab_header* slab) noexcept {
+		std::size_t bytes = slab->_bytes;
+		std::size_t align = slab->_align;
+		slab->~_Slab_header();
+		::operator delete(static_cast<void*>(slab), bytes, std::align_val_t(align));
+	}
+
+	//Deleter for objects that share one slab. Each handle destroys its own object; the last one
+	//frees the slab. The count is atomic, so handles may die on any thread. There is no default
+	//constructor: a SlabDeleter without a slab could not free anything, so an empty
+	//UniquePtr<T, SlabDeleter<T>> can only be obtained by moving from or resetting a real handle.
+	template<typename T>
+	class SlabDeleter {
+	public:
+		static constexpr bool is_concurrent = true;
+
+		SlabDeleter() = delete;
+
+		explicit SlabDeleter(_Slab_header* slab) noexcept : _slab(slab) {}
+
+		template <typename U>
+		requires std::is_convertible_v<U*, T*>
+		SlabDeleter(const SlabDeleter<U>& d) noexcept : _slab(d._slab) {}
+
+		void operator()(T* p) const noexcept {
+			p->~T();
+			if (_slab->_live.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				_Free_slab(_slab);
+			}
+		}
+
+	private:
+		template<typename U>
+		friend class SlabDeleter;
+
+		_Slab_header* _slab;
+	};
+
+	//Constructs n objects from the same arguments in one contiguous slab and returns an
+	//independent owner for each. The handles can be moved, reset and destroyed separately, in any
+	//order; the slab is freed when the last of them goes. Arguments are passed to every
+	//constructor as lvalues.
+	template<typename T, typename... Args>
+	requires (!std::is_array_v<T>)
+	std::vector<UniquePtr<T, SlabDeleter<T>>> MakeUniqueBatch(std::size_t n, const Args&... args) {
+		std::vector<UniquePtr<T, SlabDeleter<T>>> handles;
+		if (n == 0) {
+			return handles;
+		}
+		handles.reserve(n);
+		constexpr std::size_t align = std::max(alignof(T), alignof(_Slab_header));
+		constexpr std::size_t first = (sizeof(_Slab_header) + alignof(T) - 1) & ~(alignof(T) - 1);
+		if (n > (static_cast<std::size_t>(-1) - first) / sizeof(T)) {
+			throw std::bad_array_new_length();
+		}
+		std::size_t bytes = first + sizeof(T) * n;
+		unsigned char* mem = static_cast<unsigned char*>(::operator new(bytes, std::align_val_t(align)));
+		_Slab_header* slab = ::new (static_cast<void*>(mem)) _Slab_header{ {n}, bytes, align };
+		T* objects = reinterpret_cast<T*>(mem + first);
+		std::size_t built = 0;
+		try {
+			for (; built < n; ++built) {
+				::new (static_cast<void*>(objects + built)) T(args...);
+			}
+		}
+		catch (...) {
+			for (std::size_t i = built; i > 0; --i) {
+				objects[i - 1].~T();
+			}
+			_Free_slab(slab);
+			throw;
+		}
+		for (std::size_t i = 0; i < n; ++i) {
+			handles.emplace_back(std::launder(objects + i), SlabDeleter<T>(slab));
+		}
+		return handles;
+	}
+}
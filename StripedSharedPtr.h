@@ -0,0 +1,80 @@
+#pragma once
+
+#include "SharedPtr.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace Rainbow3D {
+
+	inline std::uint32_t _Striped_thread_index() noexcept {
+		static std::atomic<std::uint32_t> next{ 0 };
+		thread_local std::uint32_t index = next.fetch_add(1, std::memory_order_relaxed);
+		return index;
+	}
+
+	struct alignas(64) _Striped_count {
+		std::atomic<long> _uses{ 0 };
+	};
+
+	//Striped reference count, a count policy for SharedPtr (see StripedSharedPtr). Every handle
+	//remembers the stripe it was counted in as its ticket, so each stripe is an exact count of
+	//its handles and never goes negative. The central count tracks how many stripes are non-zero
+	//and only changes on a stripe's 0->1 and 1->0 transitions; the object is freed when it drops
+	//to zero. While any handle is being copied its source keeps some stripe, and therefore the
+	//central count, above zero.
+	template<std::size_t Stripes>
+	struct StripedCount {
+		static_assert(Stripes > 0, "StripedCount needs at least one stripe");
+
+		using ticket_type = std::uint32_t;
+
+		//The calling thread's stripe.
+		static ticket_type Ticket() noexcept {
+			return static_cast<ticket_type>(_Striped_thread_index() % Stripes);
+		}
+
+		StripedCount() noexcept {
+			_stripes[Ticket()]._uses.store(1, std::memory_order_relaxed);
+		}
+
+		void Increment(ticket_type stripe) noexcept {
+			if (_stripes[stripe]._uses.fetch_add(1, std::memory_order_relaxed) == 0) {
+				_central.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		//Returns true when the last reference is gone.
+		bool Decrement(ticket_type stripe) noexcept {
+			if (_stripes[stripe]._uses.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				return _central.fetch_sub(1, std::memory_order_acq_rel) == 1;
+			}
+			return false;
+		}
+
+		//Sums the stripes without synchronisation; exact only while no other thread copies.
+		long Count() const noexcept {
+			long sum = 0;
+			for (auto& s : _stripes) {
+				sum += s._uses.load(std::memory_order_relaxed);
+			}
+			return sum;
+		}
+
+		std::atomic<long> _central{ 1 };
+		_Striped_count _stripes[Stripes];
+	};
+
+	//SharedPtr variant for objects copied by many threads at once. Copies count in the copying
+	//thread's stripe, so threads mostly touch their own cache line; moves keep the source's
+	//stripe and cost nothing. The control block is Stripes cache lines, so reserve this for a
+	//small number of heavily shared objects.
+	template<typename T, std::size_t Stripes = 32>
+	using StripedSharedPtr = SharedPtr<T, StripedCount<Stripes>>;
+
+	template<typename T, std::size_t Stripes = 32, typename... Args>
+	StripedSharedPtr<T, Stripes> MakeStripedShared(Args&&... args) {
+		return MakeShared<T, StripedCount<Stripes>>(std::forward<Args>(args)...);
+	}
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define RAINBOW3D_TAGGED_HIGH_BITS 16
+#else
+#define RAINBOW3D_TAGGED_HIGH_BITS 0
+#endif
+
+namespace Rainbow3D {
+
+	//Owning pointer that keeps a small tag inside the pointer word. Bits low tag bits live in the
+	//low bits that alignof(T) guarantees to be zero; HighBits more (x86-64 only, up to 16) live in
+	//the unused top bits of a 48-bit user-space address. Tag bit i is bit i of the value passed
+	//to SetTag, low bits first. Get() and the deleter always see the clean pointer.
+	template<typename T, unsigned Bits, unsigned HighBits = 0, typename Deleter = _Default_delete_t<T>>
+	class TaggedUniquePtr {
+		static_assert(!std::is_array_v<T>, "TaggedUniquePtr does not support arrays");
+		static_assert(HighBits <= RAINBOW3D_TAGGED_HIGH_BITS, "high tag bits are only available on x86-64 (up to 16)");
+
+		static constexpr std::uintptr_t _Low_mask = (std::uintptr_t(1) << Bits) - 1;
+		static constexpr unsigned _High_shift = sizeof(std::uintptr_t) * 8 - HighBits;
+		static constexpr std::uintptr_t _High_mask = HighBits == 0 ? 0 : ~std::uintptr_t(0) << _High_shift;
+		static constexpr std::uintptr_t _Ptr_mask = ~(_Low_mask | _High_mask);
+
+	public:
+		using deleter_type = Deleter;
+		using element_type = T;
+		using pointer = T*;
+		using tag_type = std::uintptr_t;
+
+		static_assert(std::is_same_v<typename _Get_deleter_pointer_type<T, std::remove_reference_t<Deleter>>::type, T*>, "TaggedUniquePtr needs a deleter that takes a raw pointer");
+
+		static constexpr unsigned tag_bits = Bits + HighBits;
+		static constexpr tag_type max_tag = (tag_type(1) << tag_bits) - 1;
+
+		TaggedUniquePtr(const TaggedUniquePtr&) = delete;
+		TaggedUniquePtr& operator=(const TaggedUniquePtr&) = delete;
+
+		template <typename = void>
+		requires (!std::is_pointer_v<deleter_type>) && std::is_default_constructible_v<deleter_type>
+		constexpr TaggedUniquePtr() noexcept : _v(0), _d() {}
+
+		template <typename = void>
+		requires (!std::is_pointer_v<deleter_type>) && std::is_default_constructible_v<deleter_type>
+		constexpr TaggedUniquePtr(std::nullptr_t) noexcept : _v(0), _d() {}
+
+		template <typename = void>
+		requires (!std::is_pointer_v<deleter_type>) && std::is_default_constructible_v<deleter_type>
+		explicit TaggedUniquePtr(pointer p, tag_type tag = 0) noexcept : _v(_Pack(p, tag)), _d() {}
+
+		template <typename = void>
+		requires (!std::is_lvalue_reference_v<deleter_type>) && std::is_constructible_v<deleter_type, deleter_type&&>
+		TaggedUniquePtr(pointer p, tag_type tag, deleter_type&& d) noexcept : _v(_Pack(p, tag)), _d(std::move(d)) {}
+
+		template <typename = void>
+		requires std::is_move_constructible_v<deleter_type>
+		explicit TaggedUniquePtr(UniquePtr<T, Deleter>&& r, tag_type tag = 0) noexcept : _v(_Pack(r.Get(), tag)), _d(std::forward<deleter_type>(r.GetDeleter())) {
+			r.Release();
+		}
+
+		template <typename = void>
+		requires std::is_move_constructible_v<deleter_type>
+		TaggedUniquePtr(TaggedUniquePtr&& r) noexcept : _v(std::exchange(r._v, 0)), _d(std::forward<deleter_type>(r._d)) {}
+
+		~TaggedUniquePtr() {
+			if (pointer p = Get()) {
+				_d(p);
+			}
+		}
+
+		template <typename = void>
+		requires std::is_move_assignable_v<deleter_type>
+		TaggedUniquePtr& operator=(TaggedUniquePtr&& r) noexcept {
+			if (this != std::addressof(r)) {
+				_Reset_raw(std::exchange(r._v, 0));
+				_d = std::forward<deleter_type>(r._d);
+			}
+			return *this;
+		}
+
+		TaggedUniquePtr& operator=(std::nullptr_t) noexcept {
+			Reset();
+			return *this;
+		}
+
+		//Releases ownership; the tag is dropped.
+		pointer Release() noexcept {
+			return _Unpack(std::exchange(_v, 0));
+		}
+
+		void Reset(pointer p = nullptr, tag_type tag = 0) noexcept {
+			_Reset_raw(_Pack(p, tag));
+		}
+
+		void Swap(TaggedUniquePtr& other) noexcept {
+			std::swap(_v, other._v);
+			std::swap(_d, other._d);
+		}
+
+		pointer Get() const noexcept {
+			return _Unpack(_v);
+		}
+
+		tag_type GetTag() const noexcept {
+			tag_type tag = _v & _Low_mask;
+			if constexpr (HighBits != 0) {
+				tag |= (_v >> _High_shift) << Bits;
+			}
+			return tag;
+		}
+
+		void SetTag(tag_type tag) noexcept {
+			_v = (_v & _Ptr_mask) | _Tag_bits(tag);
+		}
+
+		bool TestTag(unsigned bit) const noexcept {
+			return (GetTag() >> bit) & 1;
+		}
+
+		void SetTag(unsigned bit, bool value) noexcept {
+			tag_type tag = GetTag() & ~(tag_type(1) << bit);
+			SetTag(tag | (tag_type(value) << bit));
+		}
+
+		deleter_type& GetDeleter() noexcept {
+			return _d;
+		}
+
+		const deleter_type& GetDeleter() const noexcept {
+			return _d;
+		}
+
+		explicit operator bool() const noexcept {
+			return Get() != nullptr;
+		}
+
+		pointer operator->() const noexcept {
+			return Get();
+		}
+
+		T& operator*() const noexcept {
+			return *Get();
+		}
+
+	private:
+		static std::uintptr_t _Tag_bits(tag_type tag) noexcept {
+			std::uintptr_t v = tag & _Low_mask;
+			if constexpr (HighBits != 0) {
+				v |= (tag >> Bits) << _High_shift;
+			}
+			return v;
+		}
+
+		//T may still be incomplete where the class is instantiated (tree nodes own their children),
+		//so the alignment check waits until a pointer is actually stored.
+		static std::uintptr_t _Pack(pointer p, tag_type tag) noexcept {
+			static_assert(Bits <= static_cast<unsigned>(std::countr_zero(alignof(T))), "alignof(T) does not leave enough low bits for the tag");
+			assert((reinterpret_cast<std::uintptr_t>(p) & _High_mask) == 0 && "pointer uses the high bits reserved for the tag");
+			return reinterpret_cast<std::uintptr_t>(p) | _Tag_bits(tag);
+		}
+
+		static pointer _Unpack(std::uintptr_t v) noexcept {
+			return reinterpret_cast<pointer>(v & _Ptr_mask);
+		}
+
+		void _Reset_raw(std::uintptr_t v) noexcept {
+			pointer old = _Unpack(std::exchange(_v, v));
+			if (old) {
+				_d(old);
+			}
+		}
+
+		std::uintptr_t _v;
+		RAINBOW3D_NO_UNIQUE_ADDRESS deleter_type _d;
+	};
+
+	//With an empty deleter the tag costs no space: the whole owner is one pointer word.
+	static_assert(sizeof(TaggedUniquePtr<std::max_align_t, 4>) == sizeof(void*));
+	static_assert(sizeof(TaggedUniquePtr<std::max_align_t, 4, RAINBOW3D_TAGGED_HIGH_BITS>) == sizeof(void*));
+
+	template<typename T, unsigned Bits, unsigned HighBits = 0, typename... Args>
+	TaggedUniquePtr<T, Bits, HighBits> MakeTaggedUnique(typename TaggedUniquePtr<T, Bits, HighBits>::tag_type tag, Args&&... args) {
+		return TaggedUniquePtr<T, Bits, HighBits>(new T(std::forward<Args>(args)...), tag);
+	}
+}
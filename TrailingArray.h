@@ -0,0 +1,105 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace Rainbow3D {
+
+	//Block layout: [element count][T][Elem x count]. The count sits in a prefix padded to the
+	//block alignment, so T starts aligned and the elements, placed after T at the next multiple
+	//of alignof(Elem), are aligned too.
+	template<typename T, typename Elem>
+	struct _Trailing_layout {
+		static constexpr std::size_t _Align = std::max({ alignof(T), alignof(Elem), alignof(std::size_t) });
+		static constexpr std::size_t _Prefix = (sizeof(std::size_t) + _Align - 1) & ~(_Align - 1);
+		static constexpr std::size_t _Elems = (sizeof(T) + alignof(Elem) - 1) & ~(alignof(Elem) - 1);
+
+		static std::size_t _Bytes(std::size_t count) noexcept {
+			return _Prefix + _Elems + sizeof(Elem) * count;
+		}
+
+		static unsigned char* _Block(T* p) noexcept {
+			return reinterpret_cast<unsigned char*>(p) - _Prefix;
+		}
+
+		static std::size_t _Count(T* p) noexcept {
+			return *std::launder(reinterpret_cast<std::size_t*>(_Block(p)));
+		}
+
+		static Elem* _Elements(T* p) noexcept {
+			return std::launder(reinterpret_cast<Elem*>(reinterpret_cast<unsigned char*>(p) + _Elems));
+		}
+	};
+
+	//Deleter for objects made by MakeUniqueWithTrailing: destroys T, then the elements, and frees
+	//the block with its exact size. Stateless; the count is read from the block.
+	template<typename T, typename Elem>
+	struct TrailingDelete {
+		void operator()(T* p) const noexcept {
+			using _Layout = _Trailing_layout<T, Elem>;
+			std::size_t count = _Layout::_Count(p);
+			Elem* elems = _Layout::_Elements(p);
+			p->~T();
+			if constexpr (!std::is_trivially_destructible_v<Elem>) {
+				for (std::size_t i = count; i > 0; --i) {
+					elems[i - 1].~Elem();
+				}
+			}
+			::operator delete(static_cast<void*>(_Layout::_Block(p)), _Layout::_Bytes(count), std::align_val_t(_Layout::_Align));
+		}
+
+		//The elements stored behind p.
+		static std::span<Elem> Trailing(T* p) noexcept {
+			using _Layout = _Trailing_layout<T, Elem>;
+			if (!p) {
+				return {};
+			}
+			return std::span<Elem>(_Layout::_Elements(p), _Layout::_Count(p));
+		}
+	};
+
+	template<typename T, typename Elem>
+	using TrailingUniquePtr = UniquePtr<T, TrailingDelete<T, Elem>>;
+
+	template<typename T, typename Elem>
+	std::span<Elem> TrailingSpan(const TrailingUniquePtr<T, Elem>& p) noexcept {
+		return TrailingDelete<T, Elem>::Trailing(p.Get());
+	}
+
+	//Allocates a T followed by count value-initialized Elem in one block. The elements are
+	//constructed before T, so T's constructor may already fill them through
+	//TrailingDelete<T, Elem>::Trailing(this).
+	template<typename T, typename Elem, typename... Args>
+	requires (!std::is_array_v<T>) && (!std::is_array_v<Elem>)
+	TrailingUniquePtr<T, Elem> MakeUniqueWithTrailing(std::size_t count, Args&&... args) {
+		using _Layout = _Trailing_layout<T, Elem>;
+		if (count > (static_cast<std::size_t>(-1) - _Layout::_Prefix - _Layout::_Elems) / sizeof(Elem)) {
+			throw std::bad_array_new_length();
+		}
+		std::size_t bytes = _Layout::_Bytes(count);
+		unsigned char* block = static_cast<unsigned char*>(::operator new(bytes, std::align_val_t(_Layout::_Align)));
+		::new (static_cast<void*>(block)) std::size_t(count);
+		unsigned char* obj = block + _Layout::_Prefix;
+		Elem* elems = reinterpret_cast<Elem*>(obj + _Layout::_Elems);
+		std::size_t built = 0;
+		try {
+			for (; built < count; ++built) {
+				::new (static_cast<void*>(elems + built)) Elem();
+			}
+			T* p = ::new (static_cast<void*>(obj)) T(std::forward<Args>(args)...);
+			return TrailingUniquePtr<T, Elem>(p);
+		}
+		catch (...) {
+			for (std::size_t i = built; i > 0; --i) {
+				elems[i - 1].~Elem();
+			}
+			::operator delete(static_cast<void*>(block), bytes, std::align_val_t(_Layout::_Align));
+			throw;
+		}
+	}
+}
@@ -1,10 +1,17 @@
 #pragma once
 
 #include <memory>
+#include <new>
 #include <type_traits>
 #include <cstddef>
 #include <utility>
 
+#if defined(_MSC_VER)
+#define RAINBOW3D_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+#else
+#define RAINBOW3D_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#endif
+
 namespace Rainbow3D {
 
 	template <typename _Ty, typename _Dx_noref, typename = void>
@@ -17,7 +24,134 @@ namespace Rainbow3D {
 		using type = typename _Dx_noref::pointer;
 	};
 
-	template<typename T, typename Deleter = std::default_delete<T>>
+	//Deleter that calls a release function fixed at compile time, e.g. UniquePtr<Window, FnDeleter<&DestroyWindow>>.
+	//It is empty, so UniquePtr stores nothing but the pointer, and the call is direct.
+	template<auto Fn>
+	struct FnDeleter {
+		template<typename T>
+		void operator()(T* p) const noexcept(noexcept(Fn(p))) {
+			Fn(p);
+		}
+	};
+
+	template <typename T>
+	inline constexpr bool _Has_class_operator_delete =
+		requires(void* p) { T::operator delete(p); } ||
+		requires(void* p) { T::operator delete(p, sizeof(T)); } ||
+		requires(void* p) { T::operator delete(p, std::align_val_t(alignof(T))); };
+
+	//True when the dynamic type behind a T* is always T, so destroying it needs no virtual dispatch.
+	template<typename T>
+	struct IsDevirtualizable : std::bool_constant<std::is_final_v<T> || !std::is_polymorphic_v<T>> {};
+
+	//Destroys and frees an object whose dynamic type is exactly T: the destructor is called by
+	//qualified name and the memory goes back through sized (and aligned) operator delete.
+	template<typename T>
+	void _Delete_exact(T* p) noexcept {
+		using U = std::remove_cv_t<T>;
+		U* q = const_cast<U*>(p);
+		if constexpr (!std::is_trivially_destructible_v<U>) {
+			q->U::~U();
+		}
+		if constexpr (alignof(U) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			::operator delete(static_cast<void*>(q), sizeof(U), std::align_val_t(alignof(U)));
+		}
+		else {
+			::operator delete(static_cast<void*>(q), sizeof(U));
+		}
+	}
+
+	//Default deleter using sized (and, for over-aligned types, aligned) deallocation, so the
+	//allocator does not have to look the block size up on free. Final and non-polymorphic types
+	//are destroyed without virtual dispatch; types whose dynamic type may differ from T and
+	//types with their own operator delete go through a plain delete-expression.
+	template<typename T>
+	struct DefaultDelete {
+		constexpr DefaultDelete() noexcept = default;
+
+		template <typename U>
+		requires std::is_convertible_v<U*, T*>
+		DefaultDelete(const DefaultDelete<U>&) noexcept {}
+
+		void operator()(T* p) const noexcept {
+			static_assert(sizeof(T) > 0, "can't delete an incomplete type");
+			if constexpr (!IsDevirtualizable<T>::value || _Has_class_operator_delete<T>) {
+				delete p;
+			}
+			else if (p) {
+				_Delete_exact(p);
+			}
+		}
+	};
+
+	//Deleter for a UniquePtr<Base> whose concrete type is known when the object is created (see
+	//MakeUniqueAs). It records a destroy function for that type, so deletion is one direct-target
+	//call with a qualified destructor and sized free instead of a virtual destructor call.
+	//A default-constructed ConcreteDelete knows no concrete type and falls back to delete on
+	//Base, which relies on Base's virtual destructor like DefaultDelete would.
+	template<typename Base>
+	class ConcreteDelete {
+	public:
+		constexpr ConcreteDelete() noexcept : _destroy(&_Destroy_base) {}
+
+		template<typename Derived>
+		requires std::is_convertible_v<Derived*, Base*> && requires(Base* p) { static_cast<Derived*>(p); }
+		static constexpr ConcreteDelete For() noexcept {
+			return ConcreteDelete(&_Destroy<Derived>);
+		}
+
+		void operator()(Base* p) const noexcept {
+			_destroy(p);
+		}
+
+	private:
+		static void _Destroy_base(Base* p) noexcept {
+			static_assert(sizeof(Base) > 0, "can't delete an incomplete type");
+			delete p;
+		}
+
+		template<typename Derived>
+		static void _Destroy(Base* p) noexcept {
+			Derived* d = static_cast<Derived*>(p);
+			if constexpr (_Has_class_operator_delete<Derived>) {
+				delete d;
+			}
+			else {
+				_Delete_exact(d);
+			}
+		}
+
+		explicit constexpr ConcreteDelete(void (*destroy)(Base*) noexcept) noexcept : _destroy(destroy) {}
+
+		void (*_destroy)(Base*) noexcept;
+	};
+
+	template<typename T>
+	struct DefaultDelete<T[]> {
+		constexpr DefaultDelete() noexcept = default;
+
+		template <typename U>
+		requires std::is_convertible_v<U(*)[], T(*)[]>
+		DefaultDelete(const DefaultDelete<U[]>&) noexcept {}
+
+		template <typename U>
+		requires std::is_convertible_v<U(*)[], T(*)[]>
+		void operator()(U* p) const noexcept {
+			static_assert(sizeof(U) > 0, "can't delete an incomplete type");
+			delete[] p;
+		}
+	};
+
+	//Define RAINBOW3D_SIZED_DEFAULT_DELETE project-wide to make DefaultDelete the default deleter.
+#if defined(RAINBOW3D_SIZED_DEFAULT_DELETE)
+	template<typename T>
+	using _Default_delete_t = DefaultDelete<T>;
+#else
+	template<typename T>
+	using _Default_delete_t = std::default_delete<T>;
+#endif
+
+	template<typename T, typename Deleter = _Default_delete_t<T>>
 	class UniquePtr {
 	public:
 		using deleter_type = Deleter;
@@ -61,10 +195,7 @@ namespace Rainbow3D {
 
 		template <typename U, typename E>
 		requires std::is_convertible_v<typename UniquePtr<U, E>::pointer, pointer> && !std::is_array_v<U> && std::conditional_t<std::is_reference_v<deleter_type>, std::is_same<deleter_type, E>, std::is_convertible<E, deleter_type>>::value
-		UniquePtr(UniquePtr<U, E>&& r) noexcept {
-			_ptr = r.Release();
-			_d = std::forward<E>(r.GetDeleter());
-		}
+		UniquePtr(UniquePtr<U, E>&& r) noexcept : _ptr(r.Release()), _d(std::forward<E>(r.GetDeleter())) {}
 
 		~UniquePtr() {
 			if (_ptr) {
@@ -142,7 +273,7 @@ namespace Rainbow3D {
 
 	private:
 		pointer _ptr;
-		deleter_type _d;
+		RAINBOW3D_NO_UNIQUE_ADDRESS deleter_type _d;
 	};
 
 	template<typename T, typename Deleter>
@@ -202,10 +333,7 @@ namespace Rainbow3D {
 		std::is_same_v<typename UniquePtr<U, E>::pointer , other_emement_type*> && 
 		std::is_convertible_v<other_emement_type(*)[], element_type(*)[]> && 
 		std::conditional_t<std::is_reference_v<deleter_type>, std::is_same<deleter_type, E>, std::is_convertible<E, deleter_type>>::value
-		UniquePtr(UniquePtr<U, E>&& r) noexcept {
-			_ptr = r.Release();
-			_d = std::forward<E>(r.GetDeleter());
-		}
+		UniquePtr(UniquePtr<U, E>&& r) noexcept : _ptr(r.Release()), _d(std::forward<E>(r.GetDeleter())) {}
 
 		~UniquePtr() {
 			if (_ptr) {
@@ -291,12 +419,37 @@ namespace Rainbow3D {
 		}
 
 		T& operator[](std::size_t i) const {
-			return Get[i];
+			return Get()[i];
 		}
 
 	private:
 
 		pointer _ptr;
-		deleter_type _d;
+		RAINBOW3D_NO_UNIQUE_ADDRESS deleter_type _d;
 	};
+
+	template<typename T, typename... Args>
+	requires (!std::is_array_v<T>)
+	UniquePtr<T> MakeUnique(Args&&... args) {
+		return UniquePtr<T>(new T(std::forward<Args>(args)...));
+	}
+
+	template<typename T>
+	requires std::is_unbounded_array_v<T>
+	UniquePtr<T> MakeUnique(std::size_t n) {
+		return UniquePtr<T>(new std::remove_extent_t<T>[n]());
+	}
+
+	//Creates a Derived owned through a UniquePtr<Base> that deletes it as a Derived.
+	template<typename Base, typename Derived, typename... Args>
+	requires (!std::is_array_v<Derived>)
+	UniquePtr<Base, ConcreteDelete<Base>> MakeUniqueAs(Args&&... args) {
+		return UniquePtr<Base, ConcreteDelete<Base>>(new Derived(std::forward<Args>(args)...), ConcreteDelete<Base>::template For<Derived>());
+	}
+
+	inline void _Test_release(int*) noexcept {}
+
+	//Empty deleters take no space, so a C handle owner is exactly one pointer.
+	static_assert(sizeof(UniquePtr<int, FnDeleter<&_Test_release>>) == sizeof(int*));
+	static_assert(sizeof(UniquePtr<int, DefaultDelete<int>>) == sizeof(int*));
 }
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "UniquePtr.h"
+#include <concepts>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace Rainbow3D {
+
+	//Copies through T::Clone() when T has one (the usual polymorphic prototype), otherwise
+	//through T's copy constructor. Both allocate with new, matching the default deleter. The copy
+	//constructor is only used for non-polymorphic or final types, since anything else could slice.
+	template<typename T>
+	struct DefaultCopier {
+		T* operator()(const T& src) const {
+			if constexpr (requires { { src.Clone() } -> std::convertible_to<T*>; }) {
+				return src.Clone();
+			}
+			else {
+				static_assert(!std::is_polymorphic_v<T> || std::is_final_v<T>, "copying a polymorphic T by its copy constructor slices; give T a Clone() or use a custom copier");
+				return new T(src);
+			}
+		}
+	};
+
+	//UniquePtr with value semantics: copying clones the owned object through Copier, moving
+	//transfers the pointer. Copier and Deleter have to agree on where copies live, so a pool or
+	//arena copier is paired with the deleter that returns memory there; stateless pairs add no
+	//size over a plain pointer.
+	template<typename T, typename Copier = DefaultCopier<T>, typename Deleter = _Default_delete_t<T>>
+	class ValuePtr {
+	public:
+		using element_type = T;
+		using copier_type = Copier;
+		using deleter_type = Deleter;
+		using pointer = typename UniquePtr<T, Deleter>::pointer;
+
+		constexpr ValuePtr() noexcept = default;
+
+		constexpr ValuePtr(std::nullptr_t) noexcept {}
+
+		explicit ValuePtr(pointer p) noexcept : _ptr(p) {}
+
+		ValuePtr(pointer p, Copier c, Deleter d) noexcept : _ptr(p, std::move(d)), _c(std::move(c)) {}
+
+		explicit ValuePtr(UniquePtr<T, Deleter>&& p, Copier c = Copier()) noexcept : _ptr(std::move(p)), _c(std::move(c)) {}
+
+		ValuePtr(const ValuePtr& r) : _ptr(r._Clone(), r._ptr.GetDeleter()), _c(r._c) {}
+
+		ValuePtr(ValuePtr&& r) noexcept = default;
+
+		ValuePtr& operator=(const ValuePtr& r) {
+			if (this != std::addressof(r)) {
+				ValuePtr(r).Swap(*this);
+			}
+			return *this;
+		}
+
+		ValuePtr& operator=(ValuePtr&& r) noexcept = default;
+
+		ValuePtr& operator=(std::nullptr_t) noexcept {
+			Reset();
+			return *this;
+		}
+
+		pointer Release() noexcept {
+			return _ptr.Release();
+		}
+
+		void Reset(pointer p = nullptr) noexcept {
+			_ptr.Reset(p);
+		}
+
+		void Swap(ValuePtr& other) noexcept {
+			_ptr.Swap(other._ptr);
+			std::swap(_c, other._c);
+		}
+
+		pointer Get() const noexcept {
+			return _ptr.Get();
+		}
+
+		copier_type& GetCopier() noexcept {
+			return _c;
+		}
+
+		const copier_type& GetCopier() const noexcept {
+			return _c;
+		}
+
+		deleter_type& GetDeleter() noexcept {
+			return _ptr.GetDeleter();
+		}
+
+		const deleter_type& GetDeleter() const noexcept {
+			return _ptr.GetDeleter();
+		}
+
+		explicit operator bool() const noexcept {
+			return Get() != nullptr;
+		}
+
+		pointer operator->() const noexcept {
+			return Get();
+		}
+
+		T& operator*() const noexcept {
+			return *_ptr;
+		}
+
+	private:
+		pointer _Clone() const {
+			return _ptr ? _c(*_ptr) : nullptr;
+		}
+
+		UniquePtr<T, Deleter> _ptr;
+		RAINBOW3D_NO_UNIQUE_ADDRESS copier_type _c;
+	};
+
+	template<typename T, typename... Args>
+	ValuePtr<T> MakeValue(Args&&... args) {
+		return ValuePtr<T>(new T(std::forward<Args>(args)...));
+	}
+}